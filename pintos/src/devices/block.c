@@ -19,6 +19,7 @@ struct block
 
     unsigned long long read_cnt;        /* Number of sectors read. */
     unsigned long long write_cnt;       /* Number of sectors written. */
+    unsigned long long write_req_cnt;   /* Number of write requests. */
   };
 
 /* List of all block devices. */
@@ -137,6 +138,40 @@ block_write (struct block *block, block_sector_t sector, const void *buffer)
   ASSERT (block->type != BLOCK_FOREIGN);
   block->ops->write (block->aux, sector, buffer);
   block->write_cnt++;
+  block->write_req_cnt++;
+}
+
+/* Writes CNT consecutive sectors to BLOCK, starting at SECTOR,
+   from BUFFERS[0] through BUFFERS[CNT - 1], each of which must
+   contain BLOCK_SECTOR_SIZE bytes.  The device is given them as
+   a single request if its driver supports that, which saves a
+   command and a seek per sector.  Returns after the block device
+   has acknowledged receiving all the data.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void
+block_write_multiple (struct block *block, block_sector_t sector,
+                      const void *buffers[], size_t cnt)
+{
+  size_t i;
+
+  if (cnt == 0)
+    return;
+  check_sector (block, sector);
+  check_sector (block, sector + cnt - 1);
+  ASSERT (block->type != BLOCK_FOREIGN);
+  if (block->ops->write_multiple != NULL)
+    {
+      block->ops->write_multiple (block->aux, sector, buffers, cnt);
+      block->write_req_cnt++;
+    }
+  else
+    for (i = 0; i < cnt; i++)
+      {
+        block->ops->write (block->aux, sector + i, buffers[i]);
+        block->write_req_cnt++;
+      }
+  block->write_cnt += cnt;
 }
 
 /* Returns the number of sectors in BLOCK. */
@@ -200,6 +235,7 @@ block_register (const char *name, enum block_type type,
   block->aux = aux;
   block->read_cnt = 0;
   block->write_cnt = 0;
+  block->write_req_cnt = 0;
 
   printf ("%s: %'"PRDSNu" sectors (", block->name, block->size);
   print_human_readable_size ((uint64_t) block->size * BLOCK_SECTOR_SIZE);
@@ -221,7 +257,15 @@ list_elem_to_block (struct list_elem *list_elem)
           : NULL);
 }
 
+long long get_device_read_cnt (struct block *device) {
+  return device->read_cnt;
+}
+
 long long get_device_write_cnt (struct block *device) {
   return device->write_cnt;
 }
 
+long long get_device_write_req_cnt (struct block *device) {
+  return device->write_req_cnt;
+}
+
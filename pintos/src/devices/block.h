@@ -53,6 +53,8 @@ struct block *block_next (struct block *);
 block_sector_t block_size (struct block *);
 void block_read (struct block *, block_sector_t, void *);
 void block_write (struct block *, block_sector_t, const void *);
+void block_write_multiple (struct block *, block_sector_t,
+                           const void *buffers[], size_t cnt);
 const char *block_name (struct block *);
 enum block_type block_type (struct block *);
 
@@ -65,6 +67,11 @@ struct block_operations
   {
     void (*read) (void *aux, block_sector_t, void *buffer);
     void (*write) (void *aux, block_sector_t, const void *buffer);
+
+    /* Writes CNT consecutive sectors in one request.  May be
+       null, in which case each sector is written separately. */
+    void (*write_multiple) (void *aux, block_sector_t,
+                            const void *buffers[], size_t cnt);
   };
 
 struct block *block_register (const char *name, enum block_type,
@@ -72,6 +79,8 @@ struct block *block_register (const char *name, enum block_type,
                               const struct block_operations *, void *aux);
 
 
+long long get_device_read_cnt (struct block *);
 long long get_device_write_cnt (struct block *);
+long long get_device_write_req_cnt (struct block *);
 
 #endif /* devices/block.h */
@@ -1,12 +1,190 @@
 #include "filesys/directory.h"
 #include <stdio.h>
 #include <string.h>
+#include <hash.h>
 #include <list.h>
+#include <round.h>
+#include <stddef.h>
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 #include "devices/block.h"
 
+/* Directory entry cache.  Remembers, for recently looked up
+   names, which inode each names in which directory, or that it
+   names none, so that resolving a path whose directories have
+   all been seen before reads no directory data at all. */
+#define DCACHE_CNT 256                  /* Most names remembered. */
+
+/* One remembered name. */
+struct dcache_entry
+  {
+    struct hash_elem elem;              /* Element in dcache. */
+    struct list_elem lru_elem;          /* Element in dcache_lru. */
+    block_sector_t parent;              /* Directory's inode sector. */
+    char name[NAME_MAX + 1];            /* Name within it. */
+    bool present;                       /* Does NAME exist? */
+    block_sector_t sector;              /* If so, its inode sector. */
+    bool is_dir;                        /* If so, is it a directory? */
+  };
+
+static struct hash dcache;              /* Entries by parent and name. */
+static struct list dcache_lru;          /* Entries, most recent first. */
+static struct lock dcache_lock;         /* Protects all of the above. */
+
+/* Bumped by every change to a directory, so that a lookup that
+   raced with one does not remember what it read. */
+static unsigned dcache_gen;
+
+static unsigned
+dcache_hash (const struct hash_elem *e_, void *aux UNUSED)
+{
+  const struct dcache_entry *e = hash_entry (e_, struct dcache_entry, elem);
+  return hash_string (e->name) ^ hash_int (e->parent);
+}
+
+static bool
+dcache_less (const struct hash_elem *a_, const struct hash_elem *b_,
+             void *aux UNUSED)
+{
+  const struct dcache_entry *a = hash_entry (a_, struct dcache_entry, elem);
+  const struct dcache_entry *b = hash_entry (b_, struct dcache_entry, elem);
+  if (a->parent != b->parent)
+    return a->parent < b->parent;
+  return strcmp (a->name, b->name) < 0;
+}
+
+/* Initializes the directory module. */
+void
+dir_init (void)
+{
+  if (!hash_init (&dcache, dcache_hash, dcache_less, NULL))
+    PANIC ("can't allocate directory entry cache");
+  list_init (&dcache_lru);
+  lock_init (&dcache_lock);
+}
+
+/* Returns the cache entry for NAME in directory PARENT, or a null
+   pointer.  The caller must hold dcache_lock. */
+static struct dcache_entry *
+dcache_find (block_sector_t parent, const char *name)
+{
+  struct dcache_entry key;
+  struct hash_elem *e;
+
+  key.parent = parent;
+  strlcpy (key.name, name, sizeof key.name);
+  e = hash_find (&dcache, &key.elem);
+  return e != NULL ? hash_entry (e, struct dcache_entry, elem) : NULL;
+}
+
+/* Removes cache entry E.  The caller must hold dcache_lock. */
+static void
+dcache_drop (struct dcache_entry *e)
+{
+  hash_delete (&dcache, &e->elem);
+  list_remove (&e->lru_elem);
+  free (e);
+}
+
+/* Looks NAME up in directory PARENT in the cache.  Returns true
+   if it is there, setting *PRESENT to whether NAME exists and, if
+   it does, *EP to its directory entry. */
+static bool
+dcache_get (block_sector_t parent, const char *name, bool *present,
+            struct dir_entry *ep)
+{
+  struct dcache_entry *e;
+
+  if (strlen (name) > NAME_MAX)
+    return false;
+  lock_acquire (&dcache_lock);
+  e = dcache_find (parent, name);
+  if (e != NULL)
+    {
+      list_remove (&e->lru_elem);
+      list_push_front (&dcache_lru, &e->lru_elem);
+      *present = e->present;
+      if (e->present && ep != NULL)
+        {
+          ep->inode_sector = e->sector;
+          strlcpy (ep->name, e->name, sizeof ep->name);
+          ep->in_use = true;
+          ep->is_dir = e->is_dir;
+        }
+    }
+  lock_release (&dcache_lock);
+  return e != NULL;
+}
+
+/* Remembers that NAME in directory PARENT names the inode in
+   entry E, or nothing if E is null, unless a directory has
+   changed since dcache_gen was GEN. */
+static void
+dcache_put (block_sector_t parent, const char *name,
+            const struct dir_entry *e, unsigned gen)
+{
+  struct dcache_entry *d;
+
+  if (strlen (name) > NAME_MAX)
+    return;
+  lock_acquire (&dcache_lock);
+  if (gen == dcache_gen && dcache_find (parent, name) == NULL)
+    {
+      if (hash_size (&dcache) >= DCACHE_CNT)
+        dcache_drop (list_entry (list_back (&dcache_lru),
+                                 struct dcache_entry, lru_elem));
+      d = malloc (sizeof *d);
+      if (d != NULL)
+        {
+          d->parent = parent;
+          strlcpy (d->name, name, sizeof d->name);
+          d->present = e != NULL;
+          d->sector = e != NULL ? e->inode_sector : 0;
+          d->is_dir = e != NULL && e->is_dir;
+          hash_insert (&dcache, &d->elem);
+          list_push_front (&dcache_lru, &d->lru_elem);
+        }
+    }
+  lock_release (&dcache_lock);
+}
+
+/* Forgets NAME in directory PARENT, which has just been added
+   or removed. */
+static void
+dcache_invalidate (block_sector_t parent, const char *name)
+{
+  struct dcache_entry *e;
+
+  lock_acquire (&dcache_lock);
+  dcache_gen++;
+  e = strlen (name) <= NAME_MAX ? dcache_find (parent, name) : NULL;
+  if (e != NULL)
+    dcache_drop (e);
+  lock_release (&dcache_lock);
+}
+
+/* Forgets every name in directory PARENT, which has just been
+   removed, so that nothing is remembered about it if its sector
+   is reused, or is being rewritten in hashed form. */
+static void
+dcache_purge (block_sector_t parent)
+{
+  struct list_elem *e, *next;
+
+  lock_acquire (&dcache_lock);
+  dcache_gen++;
+  for (e = list_begin (&dcache_lru); e != list_end (&dcache_lru); e = next)
+    {
+      struct dcache_entry *d = list_entry (e, struct dcache_entry, lru_elem);
+      next = list_next (e);
+      if (d->parent == parent)
+        dcache_drop (d);
+    }
+  lock_release (&dcache_lock);
+}
+
 /* Creates a directory with space for ENTRY_CNT entries in the
    given SECTOR.  Returns true if successful, false on failure. */
 bool
@@ -23,6 +201,7 @@ dir_open (struct inode *inode)
   struct dir *dir = calloc (1, sizeof *dir);
   if (inode != NULL && dir != NULL)
     {
+      inode_set_metadata (inode);
       dir->inode = inode;
       dir->pos = 0;
       return dir;
@@ -69,21 +248,182 @@ dir_get_inode (struct dir *dir)
   return dir->inode;
 }
 
-/* Searches DIR for a file with the given NAME.
-   If successful, returns true, sets *EP to the directory entry
-   if EP is non-null, and sets *OFSP to the byte offset of the
-   directory entry if OFSP is non-null.
-   otherwise, returns false and ignores EP and OFSP. */
-bool
-lookup (const struct dir *dir, const char *name,
-        struct dir_entry *ep, off_t *ofsp)
+/* Reads DIR's header into *H.  Returns true if DIR is hashed,
+   false if it is a plain array of entries. */
+static bool
+read_header (const struct dir *dir, struct dir_header *h)
+{
+  return (inode_read_at (dir->inode, h, sizeof *h, 0) == sizeof *h
+          && h->magic == DIR_HASH_MAGIC);
+}
+
+/* Returns the byte offset of entry IDX of bucket BUCKET. */
+static off_t
+bucket_ofs (size_t bucket, size_t idx)
+{
+  return (1 + bucket) * BLOCK_SECTOR_SIZE + idx * sizeof (struct dir_entry);
+}
+
+/* Returns true if NAME counts toward a hashed directory's
+   entry_cnt, which leaves out "." and "..". */
+static bool
+counted_name (const char *name)
+{
+  return strcmp (name, ".") && strcmp (name, "..");
+}
+
+/* Adds DELTA to hashed directory DIR's entry count. */
+static bool
+adjust_entry_cnt (struct dir *dir, int delta)
+{
+  struct dir_header h;
+  off_t ofs = offsetof (struct dir_header, entry_cnt);
+
+  if (!read_header (dir, &h))
+    return false;
+  h.entry_cnt += delta;
+  return (inode_write_at (dir->inode, &h.entry_cnt, sizeof h.entry_cnt, ofs)
+          == sizeof h.entry_cnt);
+}
+
+/* Searches hashed directory DIR, whose header is H, for NAME, the
+   way lookup() does.  If NAME is absent and FREEP is non-null,
+   sets *FREEP to the offset of the entry NAME would be added at,
+   or -1 if the directory is full. */
+static bool
+hashed_lookup (const struct dir *dir, const struct dir_header *h,
+               const char *name, struct dir_entry *ep, off_t *ofsp,
+               off_t *freep)
+{
+  size_t bucket = hash_string (name) % h->bucket_cnt;
+  off_t free_ofs = -1;
+  size_t probe, i;
+
+  for (probe = 0; probe < h->bucket_cnt; probe++)
+    {
+      for (i = 0; i < DIR_BUCKET_ENTRIES; i++)
+        {
+          struct dir_entry e;
+          off_t ofs = bucket_ofs (bucket, i);
+
+          if (inode_read_at (dir->inode, &e, sizeof e, ofs) != sizeof e)
+            memset (&e, 0, sizeof e);
+          if (e.in_use && !strcmp (name, e.name))
+            {
+              if (ep != NULL)
+                *ep = e;
+              if (ofsp != NULL)
+                *ofsp = ofs;
+              return true;
+            }
+          if (!e.in_use && free_ofs == -1)
+            free_ofs = ofs;
+          if (!e.in_use && e.name[0] == '\0')
+            {
+              /* Never used, so NAME was never put past here. */
+              if (freep != NULL)
+                *freep = free_ofs;
+              return false;
+            }
+        }
+      bucket = (bucket + 1) % h->bucket_cnt;
+    }
+  if (freep != NULL)
+    *freep = free_ofs;
+  return false;
+}
+
+/* Rewrites plain directory DIR in hashed form.  Returns true if
+   successful, false on failure.
+
+   The plain entries all lie in DIR's first sector and the
+   buckets come after it, so every entry is copied into its
+   bucket before that sector is touched.  Only then is the first
+   sector overwritten, in one write, with the header.  If a
+   bucket cannot be written, the copies made so far are cleared
+   again, which needs no new sectors, and DIR stays a plain
+   directory with every entry it had.  (So DIR is longer than
+   one sector only after such a failure, and nothing past its
+   first sector is in use.) */
+static bool
+make_hashed (struct dir *dir)
+{
+  off_t length = inode_length (dir->inode);
+  size_t cnt = DIR_BUCKET_ENTRIES;
+  struct dir_entry *entries = malloc (cnt * sizeof *entries);
+  off_t *slots = malloc (cnt * sizeof *slots);
+  static const struct dir_entry empty;
+  uint8_t *first = NULL;
+  struct dir_header h;
+  bool success = false;
+  size_t i, copied = 0;
+
+  /* Keep concurrent lookups from caching what they read while
+     the entries move. */
+  dcache_purge (inode_get_inumber (dir->inode));
+
+  first = calloc (1, BLOCK_SECTOR_SIZE);
+  if (entries == NULL || slots == NULL || first == NULL)
+    goto done;
+  if (length < (off_t) (cnt * sizeof *entries))
+    cnt = length / sizeof *entries;
+  if (inode_read_at (dir->inode, entries, cnt * sizeof *entries, 0)
+      != (off_t) (cnt * sizeof *entries))
+    goto done;
+
+  h.magic = DIR_HASH_MAGIC;
+  h.bucket_cnt = DIR_BUCKET_CNT;
+  h.entry_cnt = 0;
+  for (i = 0; i < cnt; i++)
+    if (entries[i].in_use && counted_name (entries[i].name))
+      h.entry_cnt++;
+
+  /* Put every entry in use into its bucket. */
+  for (i = 0; i < cnt; i++)
+    {
+      off_t ofs;
+
+      if (!entries[i].in_use)
+        continue;
+      if (hashed_lookup (dir, &h, entries[i].name, NULL, NULL, &ofs)
+          || ofs == -1
+          || (inode_write_at (dir->inode, &entries[i], sizeof entries[i], ofs)
+              != sizeof entries[i]))
+        goto done;
+      slots[copied++] = ofs;
+    }
+
+  /* Switch over by replacing the plain entries with the header. */
+  memcpy (first, &h, sizeof h);
+  success = (inode_write_at (dir->inode, first, BLOCK_SECTOR_SIZE, 0)
+             == BLOCK_SECTOR_SIZE);
+
+ done:
+  if (!success)
+    for (i = 0; i < copied; i++)
+      inode_write_at (dir->inode, &empty, sizeof empty, slots[i]);
+  dcache_purge (inode_get_inumber (dir->inode));
+  free (first);
+  free (slots);
+  free (entries);
+  return success;
+}
+
+/* Searches DIR's data for a file with the given NAME, the way
+   lookup() does. */
+static bool
+lookup_disk (const struct dir *dir, const char *name,
+             struct dir_entry *ep, off_t *ofsp)
 {
+  struct dir_header h;
   struct dir_entry e;
   size_t ofs;
 
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
+  if (read_header (dir, &h))
+    return hashed_lookup (dir, &h, name, ep, ofsp, NULL);
   for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
        ofs += sizeof e)
     if (e.in_use && !strcmp (name, e.name))
@@ -97,6 +437,39 @@ lookup (const struct dir *dir, const char *name,
   return false;
 }
 
+/* Searches DIR for a file with the given NAME.
+   If successful, returns true, sets *EP to the directory entry
+   if EP is non-null, and sets *OFSP to the byte offset of the
+   directory entry if OFSP is non-null.
+   otherwise, returns false and ignores EP and OFSP.
+   Answers from the directory entry cache unless OFSP is
+   non-null, since the cache does not remember offsets. */
+bool
+lookup (const struct dir *dir, const char *name,
+        struct dir_entry *ep, off_t *ofsp)
+{
+  block_sector_t parent;
+  struct dir_entry e;
+  unsigned gen;
+  bool present;
+
+  ASSERT (dir != NULL);
+  ASSERT (name != NULL);
+
+  parent = inode_get_inumber (dir->inode);
+  if (ofsp == NULL && dcache_get (parent, name, &present, ep))
+    return present;
+
+  lock_acquire (&dcache_lock);
+  gen = dcache_gen;
+  lock_release (&dcache_lock);
+  present = lookup_disk (dir, name, &e, ofsp);
+  dcache_put (parent, name, present ? &e : NULL, gen);
+  if (present && ep != NULL)
+    *ep = e;
+  return present;
+}
+
 /* Searches DIR for a file with the given NAME
    and returns true if one exists, false otherwise.
    On success, sets *INODE to an inode for the file, otherwise to
@@ -123,12 +496,16 @@ dir_lookup (const struct dir *dir, const char *name,
    INODE_SECTOR.
    Returns true if successful, false on failure.
    Fails if NAME is invalid (i.e. too long) or a disk or memory
-   error occurs. */
+   error occurs.  A plain directory that would grow past its first
+   sector is made hashed first, unless it uses extents, which
+   would allocate every one of its buckets up front. */
 bool
 dir_add (struct dir *dir, const char *name, block_sector_t inode_sector, bool is_dir)
 {
+  struct dir_header h;
   struct dir_entry e;
   off_t ofs;
+  bool hashed;
   bool success = false;
 
   ASSERT (dir != NULL);
@@ -138,6 +515,15 @@ dir_add (struct dir *dir, const char *name, block_sector_t inode_sector, bool is
   if (*name == '\0' || strlen (name) > NAME_MAX)
     return false;
 
+  hashed = read_header (dir, &h);
+  if (hashed)
+    {
+      /* Check that NAME is not in use, finding a free slot. */
+      if (hashed_lookup (dir, &h, name, NULL, NULL, &ofs) || ofs == -1)
+        goto done;
+      goto write;
+    }
+
   /* Check that NAME is not in use. */
   if (lookup (dir, name, NULL, NULL))
     goto done;
@@ -153,14 +539,25 @@ dir_add (struct dir *dir, const char *name, block_sector_t inode_sector, bool is
        ofs += sizeof e)
     if (!e.in_use)
       break;
+  if (ofs / sizeof e >= DIR_BUCKET_ENTRIES && inode_is_sparse (dir->inode))
+    {
+      if (!make_hashed (dir) || !read_header (dir, &h))
+        goto done;
+      hashed = true;
+      if (hashed_lookup (dir, &h, name, NULL, NULL, &ofs) || ofs == -1)
+        goto done;
+    }
 
+ write:
   /* Write slot. */
   e.in_use = true;
   e.is_dir = is_dir;
   strlcpy (e.name, name, sizeof e.name);
   e.inode_sector = inode_sector;
   success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-
+  if (success && hashed && counted_name (name))
+    success = adjust_entry_cnt (dir, 1);
+  dcache_invalidate (inode_get_inumber (dir->inode), name);
 
  done:
   return success;
@@ -191,8 +588,7 @@ dir_remove (struct dir *dir, const char *name)
 
   if (e.is_dir) {
     struct dir *d = dir_open (inode);
-    char temp[15];
-    if (dir_readdir (d, temp)
+    if (!dir_is_empty (d)
           || (d->inode->sector == thread_current ()->cwd->inode->sector)
           || is_dir_open (d)) {
       inode_close (inode);
@@ -200,10 +596,16 @@ dir_remove (struct dir *dir, const char *name)
     }
   }
 
-  /* Erase directory entry. */
+  /* Erase directory entry.  Its name stays behind, so that a
+     hashed lookup knows to keep looking past it. */
   e.in_use = false;
   if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e)
     goto done;
+  if (counted_name (name))
+    adjust_entry_cnt (dir, -1);
+  dcache_invalidate (inode_get_inumber (dir->inode), name);
+  if (e.is_dir)
+    dcache_purge (e.inode_sector);
 
   /* Remove inode. */
   inode_remove (inode);
@@ -220,11 +622,24 @@ dir_remove (struct dir *dir, const char *name)
 bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
 {
+  struct dir_header h;
   struct dir_entry e;
+  bool hashed = read_header (dir, &h);
 
+  if (hashed && dir->pos < BLOCK_SECTOR_SIZE)
+    dir->pos = BLOCK_SECTOR_SIZE;
   while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e)
     {
       dir->pos += sizeof e;
+      if (hashed)
+        {
+          /* Skip the rest of a bucket after its last entry, or
+             after the first entry never used, which comes after
+             every entry that has been. */
+          size_t idx = (dir->pos % BLOCK_SECTOR_SIZE) / sizeof e;
+          if (idx >= DIR_BUCKET_ENTRIES || (!e.in_use && e.name[0] == '\0'))
+            dir->pos = ROUND_UP (dir->pos, BLOCK_SECTOR_SIZE);
+        }
       if (e.in_use && strcmp(e.name, ".") != 0 && strcmp(e.name, "..") != 0)
         {
           strlcpy (name, e.name, NAME_MAX + 1);
@@ -233,3 +648,21 @@ dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
     }
   return false;
 }
+
+/* Returns true if DIR holds nothing but "." and "..". */
+bool
+dir_is_empty (struct dir *dir)
+{
+  struct dir_header h;
+  char name[NAME_MAX + 1];
+  off_t pos;
+  bool empty;
+
+  if (read_header (dir, &h))
+    return h.entry_cnt == 0;
+  pos = dir->pos;
+  dir->pos = 0;
+  empty = !dir_readdir (dir, name);
+  dir->pos = pos;
+  return empty;
+}
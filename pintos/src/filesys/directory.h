@@ -27,7 +27,8 @@ struct dir
     off_t pos;                          /* Current position. */
   };
 
-/* A single directory entry. */
+/* A single directory entry.  A free entry whose name is not
+   empty once held a file; one with an empty name never has. */
 struct dir_entry
   {
     block_sector_t inode_sector;        /* Sector number of header. */
@@ -36,6 +37,28 @@ struct dir_entry
     bool is_dir;
   };
 
+/* A directory starts out as a plain array of entries.  Once it
+   outgrows its first sector it is rewritten in hashed form: that
+   sector holds a struct dir_header, and each sector after it is
+   a bucket of DIR_BUCKET_ENTRIES entries.  A name lives in the
+   bucket its hash picks or, if that bucket is full, in the first
+   bucket after it with room.  Buckets never written are holes in
+   the sparse directory file and cost no disk space. */
+#define DIR_HASH_MAGIC 0x48534944       /* Marks a hashed directory. */
+#define DIR_BUCKET_CNT 2048             /* Buckets in a hashed directory. */
+#define DIR_BUCKET_ENTRIES (BLOCK_SECTOR_SIZE / sizeof (struct dir_entry))
+
+/* First bytes of a hashed directory. */
+struct dir_header
+  {
+    uint32_t magic;                     /* DIR_HASH_MAGIC. */
+    uint32_t bucket_cnt;                /* Number of buckets. */
+    uint32_t entry_cnt;                 /* Entries in use, not counting
+                                           "." and "..". */
+  };
+
+void dir_init (void);
+
 /* Opening and closing directories. */
 bool dir_create (block_sector_t sector, size_t entry_cnt);
 struct dir *dir_open (struct inode *);
@@ -50,5 +73,6 @@ bool dir_lookup (const struct dir *, const char *name, struct inode **);
 bool dir_add (struct dir *, const char *name, block_sector_t, bool is_dir);
 bool dir_remove (struct dir *, const char *name);
 bool dir_readdir (struct dir *, char name[NAME_MAX + 1]);
+bool dir_is_empty (struct dir *);
 
 #endif /* filesys/directory.h */
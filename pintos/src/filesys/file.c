@@ -15,6 +15,7 @@ file_open (struct inode *inode)
       file->inode = inode;
       file->pos = 0;
       file->deny_write = false;
+      file->direct = false;
       return file;
     }
   else
@@ -60,7 +61,7 @@ file_get_inode (struct file *file)
 off_t
 file_read (struct file *file, void *buffer, off_t size)
 {
-  off_t bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
+  off_t bytes_read = file_read_at (file, buffer, size, file->pos);
   file->pos += bytes_read;
   return bytes_read;
 }
@@ -73,6 +74,8 @@ file_read (struct file *file, void *buffer, off_t size)
 off_t
 file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs)
 {
+  if (file->direct)
+    return inode_read_direct_at (file->inode, buffer, size, file_ofs);
   return inode_read_at (file->inode, buffer, size, file_ofs);
 }
 
@@ -86,7 +89,7 @@ file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs)
 off_t
 file_write (struct file *file, const void *buffer, off_t size)
 {
-  off_t bytes_written = inode_write_at (file->inode, buffer, size, file->pos);
+  off_t bytes_written = file_write_at (file, buffer, size, file->pos);
   file->pos += bytes_written;
   return bytes_written;
 }
@@ -102,9 +105,84 @@ off_t
 file_write_at (struct file *file, const void *buffer, off_t size,
                off_t file_ofs)
 {
+  if (file->direct)
+    return inode_write_direct_at (file->inode, buffer, size, file_ofs);
   return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Reads from FILE into the IOVCNT buffers in IOV, filling each
+   in turn, starting at the file's current position.
+   Returns the number of bytes actually read,
+   which may be less than the buffers hold if end of file is
+   reached.
+   Advances FILE's position by the number of bytes read. */
+off_t
+file_readv (struct file *file, const struct iovec *iov, int iovcnt)
+{
+  off_t bytes_read = file_readv_at (file, iov, iovcnt, file->pos);
+  file->pos += bytes_read;
+  return bytes_read;
+}
+
+/* Reads from FILE into the IOVCNT buffers in IOV, filling each
+   in turn, starting at offset FILE_OFS in the file.
+   Returns the number of bytes actually read,
+   which may be less than the buffers hold if end of file is
+   reached.
+   The file's current position is unaffected. */
+off_t
+file_readv_at (struct file *file, const struct iovec *iov, int iovcnt,
+               off_t file_ofs)
+{
+  return inode_readv_at (file->inode, iov, iovcnt, file_ofs, file->direct);
+}
+
+/* Writes the IOVCNT buffers in IOV, one after another, into
+   FILE, starting at the file's current position.
+   Returns the number of bytes actually written,
+   which may be less than the buffers hold if the file cannot
+   grow that far.
+   Advances FILE's position by the number of bytes written. */
+off_t
+file_writev (struct file *file, const struct iovec *iov, int iovcnt)
+{
+  off_t bytes_written = file_writev_at (file, iov, iovcnt, file->pos);
+  file->pos += bytes_written;
+  return bytes_written;
+}
+
+/* Writes the IOVCNT buffers in IOV, one after another, into
+   FILE, starting at offset FILE_OFS in the file.
+   Returns the number of bytes actually written,
+   which may be less than the buffers hold if the file cannot
+   grow that far.
+   The file's current position is unaffected. */
+off_t
+file_writev_at (struct file *file, const struct iovec *iov, int iovcnt,
+                off_t file_ofs)
+{
+  return inode_writev_at (file->inode, iov, iovcnt, file_ofs, file->direct);
+}
+
+/* Makes whole-sector reads and writes through FILE bypass the
+   buffer cache if DIRECT is true, so that bulk transfers do not
+   push other blocks out of it. */
+void
+file_set_direct (struct file *file, bool direct)
+{
+  ASSERT (file != NULL);
+  file->direct = direct;
+}
+
+/* Writes FILE's data, and its metadata unless DATA_ONLY is true
+   and only the data changed, to disk before returning. */
+void
+file_sync (struct file *file, bool data_only)
+{
+  ASSERT (file != NULL);
+  inode_sync (file->inode, data_only);
+}
+
 /* Prevents write operations on FILE's underlying inode
    until file_allow_write() is called or FILE is closed. */
 void
@@ -14,6 +14,7 @@ struct file
     struct inode *inode;        /* File's inode. */
     off_t pos;                  /* Current position. */
     bool deny_write;            /* Has file_deny_write() been called? */
+    bool direct;                /* Bypass the cache for whole sectors? */
   };
 
 /* Opening and closing files. */
@@ -28,6 +29,20 @@ off_t file_read_at (struct file *, void *, off_t size, off_t start);
 off_t file_write (struct file *, const void *, off_t);
 off_t file_write_at (struct file *, const void *, off_t size, off_t start);
 
+/* Vectored reading and writing. */
+off_t file_readv (struct file *, const struct iovec *, int iovcnt);
+off_t file_readv_at (struct file *, const struct iovec *, int iovcnt,
+                     off_t start);
+off_t file_writev (struct file *, const struct iovec *, int iovcnt);
+off_t file_writev_at (struct file *, const struct iovec *, int iovcnt,
+                      off_t start);
+
+/* Direct I/O. */
+void file_set_direct (struct file *, bool);
+
+/* Forcing data to disk. */
+void file_sync (struct file *, bool data_only);
+
 /* Preventing writes. */
 void file_deny_write (struct file *);
 void file_allow_write (struct file *);
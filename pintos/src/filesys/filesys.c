@@ -5,12 +5,25 @@
 #include "filesys/file.h"
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
 #include "filesys/directory.h"
+#include "threads/thread.h"
 
 /* Partition that contains the file system. */
 struct block *fs_device;
 
+/* Set by filesys_crash(), after which nothing more is written. */
+static bool crashed;
+
+/* May user programs call filesys_crash()?
+   Set by the kernel command-line option -crash. */
+bool filesys_crash_enabled;
+
 static void do_format (void);
+static struct dir *resolve_parent (const char *path, char *path_copy,
+                                   char **last);
+static struct inode *open_entry (struct dir *, const char *name,
+                                 struct dir_entry *);
 
 /* Initializes the file system module.
    If FORMAT is true, reformats the file system. */
@@ -22,13 +35,18 @@ filesys_init (bool format)
     PANIC ("No file system device found, can't initialize file system.");
 
   inode_init ();
+  dir_init ();
   cache_init ();
   free_map_init ();
+  journal_init (format);
 
   if (format)
     do_format ();
 
   free_map_open ();
+  thread_create ("cache-flusher", PRI_DEFAULT, cache_flusher, NULL);
+  thread_create ("cache-readahead", PRI_DEFAULT, cache_readahead, NULL);
+  thread_create ("inode-reclaim", PRI_DEFAULT, inode_reclaimer, NULL);
 }
 
 /* Shuts down the file system module, writing any unwritten data
@@ -36,14 +54,28 @@ filesys_init (bool format)
 void
 filesys_done (void)
 {
-  int i=0;
-  for (i=0;i<CACHE_SIZE;i++){
-    evict_cache(i);
-  }
-  for (i=0;i<CACHE_SIZE;i++){
-    free(Cache[i].data);
-  }
+  if (crashed)
+    return;
+  inode_reclaim_all ();
+  journal_begin ();
   free_map_close ();
+  journal_end ();
+  journal_commit ();
+  cache_done ();
+}
+
+/* Simulates a power failure for crash-recovery tests: commits
+   the metadata journal but applies only part of the commit,
+   writes back everything else, and stops the journal.  Nothing
+   changed afterward is sure to reach the disk, and shutting down
+   writes nothing, so the next boot must recover from the
+   journal.  The caller should shut down soon after. */
+void
+filesys_crash (void)
+{
+  journal_crash ();
+  cache_flush ();
+  crashed = true;
 }
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
@@ -54,6 +86,7 @@ bool
 filesys_create (const char *name, off_t initial_size)
 {
   block_sector_t inode_sector = 0;
+  journal_begin ();
   struct dir *dir = dir_open_root ();
   bool success = (dir != NULL
                   && free_map_allocate (1, &inode_sector)
@@ -62,6 +95,7 @@ filesys_create (const char *name, off_t initial_size)
   if (!success && inode_sector != 0)
     free_map_release (inode_sector, 1);
   dir_close (dir);
+  journal_end ();
 
   return success;
 }
@@ -76,47 +110,40 @@ filesys_create_r (const char *path, off_t initial_size, bool is_dir)
     return false;
   }
 
-  struct dir *dir_ptr;
-  if (path[0] == '/') {
-    dir_ptr = dir_open_root ();
-  } else {
-    dir_ptr = dir_reopen (thread_current ()->cwd);
-  }
-
-  char path_copy[strlen(path)];
-  strlcpy (path_copy, path, strlen(path) + 1);
-  char *save_ptr;
-  char *cur = strtok_r(path_copy, "/", &save_ptr);
-  char *next = strtok_r(NULL, "/", &save_ptr);
-  struct inode *inode_ptr;
-  while (next != NULL) {
-    if (!dir_lookup(dir_ptr, cur, &inode_ptr)) {
-      dir_close (dir_ptr);
-      return false;
-    } else {
-      dir_close(dir_ptr);
-      dir_ptr = dir_open(inode_ptr);
-      cur = next;
-      next = strtok_r(NULL, "/", &save_ptr);
-    }
+  char path_copy[strlen(path) + 1];
+  char *cur;
+  struct dir *dir_ptr = resolve_parent (path, path_copy, &cur);
+  if (dir_ptr == NULL || cur == NULL) {
+    dir_close (dir_ptr);
+    return false;
   }
+  journal_begin ();
 
   bool success;
   block_sector_t inode_sector = 0;
+  /* Holding the parent open keeps its sector from being reused,
+     but it may have been removed since it was looked up, and
+     must not gain entries then.  Put the new inode close to its
+     parent directory's. */
   if (is_dir) {
-    success = (dir_ptr != NULL && free_map_allocate (1, &inode_sector)
+    success = (!dir_ptr->inode->removed
+      && free_map_allocate_near (1, dir_ptr->inode->sector, &inode_sector)
       && dir_create (inode_sector, initial_size) 
       && dir_add (dir_ptr, cur, inode_sector, true));
 
     // Create . and .. dir_entries
-    struct inode *child_inode;
-    dir_lookup (dir_ptr, cur, &child_inode);
-    struct dir *dir_child = dir_open (child_inode);
-    dir_add (dir_child, ".", dir_child->inode->sector, true);
-    dir_add (dir_child, "..", dir_ptr->inode->sector, true);
+    if (success) {
+      struct dir *dir_child = dir_open (inode_open (inode_sector));
+      if (dir_child != NULL) {
+        dir_add (dir_child, ".", dir_child->inode->sector, true);
+        dir_add (dir_child, "..", dir_ptr->inode->sector, true);
+      }
+      dir_close (dir_child);
+    }
 
   } else {
-    success = (dir_ptr != NULL && free_map_allocate (1, &inode_sector)
+    success = (!dir_ptr->inode->removed
+      && free_map_allocate_near (1, dir_ptr->inode->sector, &inode_sector)
       && inode_create (inode_sector, initial_size) 
       && dir_add (dir_ptr, cur, inode_sector, false));
   }
@@ -124,6 +151,7 @@ filesys_create_r (const char *path, off_t initial_size, bool is_dir)
   dir_close (dir_ptr);
   if (!success && inode_sector != 0)
     free_map_release (inode_sector, 1);
+  journal_end ();
   return success;
 }
 
@@ -131,30 +159,29 @@ filesys_create_r (const char *path, off_t initial_size, bool is_dir)
 bool
 filesys_chdir (struct thread *t, char *path)
 {
-  struct dir *dir_ptr;
   if (strcmp(path, "/") == 0) {
     dir_close (t->cwd);
     t->cwd = dir_open_root ();
     return t->cwd != NULL;
-  } else if (path[0] == '/') {
-    dir_ptr = dir_open_root ();
-  } else {
-    dir_ptr = dir_reopen (t->cwd);
   }
 
-  char path_copy[strlen(path)];
-  strlcpy (path_copy, path, strlen(path) + 1);
-  char *save_ptr;
-  char *chunk = strtok_r(path_copy, "/", &save_ptr);
-  struct inode *inode_ptr;
-  while (chunk != NULL) {
-    if (!dir_lookup(dir_ptr, chunk, &inode_ptr)) {
-      dir_close (dir_ptr);
+  char path_copy[strlen(path) + 1];
+  char *cur;
+  struct dir_entry e;
+  struct dir *dir_ptr = resolve_parent (path, path_copy, &cur);
+  if (dir_ptr == NULL) {
+    return false;
+  }
+  if (cur != NULL) {
+    struct inode *inode = open_entry (dir_ptr, cur, &e);
+    dir_close (dir_ptr);
+    if (inode == NULL || !e.is_dir) {
+      inode_close (inode);
+      return false;
+    }
+    dir_ptr = dir_open (inode);
+    if (dir_ptr == NULL) {
       return false;
-    } else {
-      dir_close(dir_ptr);
-      dir_ptr = dir_open(inode_ptr);
-      chunk = strtok_r(NULL, "/", &save_ptr);
     }
   }
 
@@ -190,50 +217,38 @@ filesys_open_r (const char *path, struct fd_obj *dest)
     return false;
   }
 
-  struct dir *dir_ptr;
   if (strcmp(path, "/") == 0) {
     dest->dir_ptr = dir_open_root ();
     dest->is_dir = true;
     return dest->dir_ptr != NULL;
-  } else if (path[0] == '/') {
-    dir_ptr = dir_open_root ();
-  } else {
-    dir_ptr = dir_reopen (thread_current ()->cwd);
-  }
-
-  char path_copy[strlen(path)];
-  strlcpy (path_copy, path, strlen(path) + 1);
-  char *save_ptr;
-  char *cur = strtok_r(path_copy, "/", &save_ptr);
-  char *next = strtok_r(NULL, "/", &save_ptr);
-  struct inode *inode_ptr;
-  while (next != NULL) {
-    if (!dir_lookup(dir_ptr, cur, &inode_ptr)) {
-      dir_close (dir_ptr);
-      return false;
-    } else {
-      dir_close(dir_ptr);
-      dir_ptr = dir_open(inode_ptr);
-      cur = next;
-      next = strtok_r(NULL, "/", &save_ptr);
-    }
   }
 
+  char path_copy[strlen(path) + 1];
+  char *cur;
   struct dir_entry e;
-  if (!lookup (dir_ptr, cur, &e, NULL)) {
-    dir_close (dir_ptr);
+  struct dir *parent = resolve_parent (path, path_copy, &cur);
+  if (parent == NULL) {
     return false;
   }
-  
+  if (cur == NULL) {
+    dest->dir_ptr = parent;
+    dest->is_dir = true;
+    return true;
+  }
+  struct inode *inode = open_entry (parent, cur, &e);
+  dir_close (parent);
+  if (inode == NULL) {
+    return false;
+  }
+
   if (e.is_dir) {
-    dest->dir_ptr = dir_open (inode_open (e.inode_sector));
+    dest->dir_ptr = dir_open (inode);
     dest->is_dir = true;
   } else {
-    dest->file_ptr = file_open (inode_open (e.inode_sector));
+    dest->file_ptr = file_open (inode);
     dest->is_dir = false;
   }
 
-  dir_close (dir_ptr);
   return dest->dir_ptr != NULL || dest->file_ptr != NULL;
 }
 
@@ -244,43 +259,103 @@ filesys_open_r (const char *path, struct fd_obj *dest)
 bool
 filesys_remove (const char *path)
 {
-  struct dir *dir_ptr;
   if (strcmp(path, "/") == 0) {
     return false;
-  } else if (path[0] == '/') {
-    dir_ptr = dir_open_root ();
-  } else {
-    dir_ptr = dir_reopen (thread_current ()->cwd);
   }
 
-  char path_copy[strlen(path)];
-  strlcpy (path_copy, path, strlen(path) + 1);
-  char *save_ptr;
-  char *cur = strtok_r(path_copy, "/", &save_ptr);
-  char *next = strtok_r(NULL, "/", &save_ptr);
-  struct inode *inode_ptr;
-  while (next != NULL) {
-    if (!dir_lookup(dir_ptr, cur, &inode_ptr)) {
-      dir_close (dir_ptr);
-      return false;
-    } else {
-      dir_close(dir_ptr);
-      dir_ptr = dir_open(inode_ptr);
-      cur = next;
-      next = strtok_r(NULL, "/", &save_ptr);
-    }
+  char path_copy[strlen(path) + 1];
+  char *cur;
+  struct dir *dir_ptr = resolve_parent (path, path_copy, &cur);
+  if (dir_ptr == NULL || cur == NULL) {
+    dir_close (dir_ptr);
+    return false;
   }
+  journal_begin ();
 
-  bool success = dir_ptr != NULL && dir_remove (dir_ptr, cur);
+  bool success = dir_remove (dir_ptr, cur);
   dir_close (dir_ptr);
+  journal_end ();
   return success;
 }
 
+/* Looks up every component of PATH but the last, starting from
+   the root directory if PATH is absolute or the current
+   directory otherwise.  PATH_COPY must have room for PATH; it
+   receives the tokenized path.  If successful, returns the
+   directory the last component is in, opened, and sets *LAST to
+   that component, or to a null pointer if PATH has no
+   components.  The caller must close the directory.  Returns a
+   null pointer on failure.
+
+   Each directory on the way is opened before the one it is in
+   is closed, so none of them can be removed and have its sector
+   reused while the walk still depends on it. */
+static struct dir *
+resolve_parent (const char *path, char *path_copy, char **last)
+{
+  struct dir_entry e;
+  char *save_ptr, *cur, *next;
+  struct dir *dir;
+
+  if (path[0] == '/')
+    dir = dir_open_root ();
+  else
+    dir = dir_reopen (thread_current ()->cwd);
+
+  strlcpy (path_copy, path, strlen (path) + 1);
+  cur = strtok_r (path_copy, "/", &save_ptr);
+  next = cur != NULL ? strtok_r (NULL, "/", &save_ptr) : NULL;
+  while (next != NULL && dir != NULL)
+    {
+      struct inode *inode = open_entry (dir, cur, &e);
+      dir_close (dir);
+      if (inode == NULL || !e.is_dir)
+        {
+          inode_close (inode);
+          return NULL;
+        }
+      dir = dir_open (inode);
+      cur = next;
+      next = strtok_r (NULL, "/", &save_ptr);
+    }
+  *last = cur;
+  return dir;
+}
+
+/* Looks up NAME in DIR, which the caller holds open, copying its
+   entry into *E, and opens the inode it names.  Returns the
+   inode, which the caller must close, or a null pointer if there
+   is no such entry.  The entry is looked up again once the inode
+   is open: if it was removed in between, its sector may already
+   belong to another file, so the inode is not returned unless it
+   is still live and DIR still names it. */
+static struct inode *
+open_entry (struct dir *dir, const char *name, struct dir_entry *e)
+{
+  struct dir_entry check;
+  struct inode *inode;
+
+  if (!lookup (dir, name, e, NULL))
+    return NULL;
+  inode = inode_open (e->inode_sector);
+  if (inode != NULL
+      && (inode->removed
+          || !lookup (dir, name, &check, NULL)
+          || check.inode_sector != e->inode_sector
+          || check.is_dir != e->is_dir))
+    {
+      inode_close (inode);
+      return NULL;
+    }
+  return inode;
+}
+
 /* Formats the file system. */
 static void
 do_format (void)
 {
   printf ("Formatting file system...");
+  journal_begin ();
   free_map_create ();
   if (!dir_create (ROOT_DIR_SECTOR, 16))
     PANIC ("root directory creation failed");
@@ -290,6 +365,8 @@ do_format (void)
   struct dir *root = dir_open_root ();
   dir_add (root, ".", root->inode->sector, true);
   dir_add (root, "..", root->inode->sector, true);
+  dir_close (root);
+  journal_end ();
   printf ("done.\n");
 }
 
@@ -22,6 +22,8 @@ struct block *fs_device;
 
 void filesys_init (bool format);
 void filesys_done (void);
+extern bool filesys_crash_enabled;
+void filesys_crash (void);
 bool filesys_create (const char *name, off_t initial_size);
 bool filesys_create_r (const char *path, off_t initial_size, bool is_dir);
 bool filesys_chdir (struct thread *t, char *path);
@@ -1,22 +1,208 @@
 #include "filesys/free-map.h"
 #include <bitmap.h>
 #include <debug.h>
+#include <round.h>
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per sector. */
+static struct bitmap *dirty_map;     /* Free map file sectors that
+                                        differ from the free map. */
+static struct lock free_map_lock;    /* Held while using the free map,
+                                        and across free_map_defer(). */
+static int defer_depth;              /* Open free_map_defer() calls. */
+static bool deferred_write;          /* Changed while writes deferred? */
+static bool defer_locked;            /* Outermost free_map_defer() took
+                                        free_map_lock? */
+static unsigned write_cnt;           /* Times free map was written. */
+static unsigned sector_write_cnt;    /* Free map file sectors written. */
+static unsigned alloc_cnt;           /* Successful allocations. */
+static unsigned scan_cnt;            /* Free map bits examined. */
+
+/* Sectors per block group.  The free map keeps a count of free
+   sectors in each group, so that allocation can step over full
+   groups without looking at their bits. */
+#define GROUP_SIZE 512
+static size_t group_cnt;             /* Number of block groups. */
+static size_t *group_free;           /* Free sectors in each group. */
+
+/* Free map bits held by one sector of the free map file. */
+#define BITS_PER_SECTOR (BLOCK_SECTOR_SIZE * 8)
+
+/* Notes that free map bits START through START + CNT - 1 have
+   changed, so the sectors of the free map file holding them have
+   to be written. */
+static void
+mark_dirty (size_t start, size_t cnt)
+{
+  size_t first = start / BITS_PER_SECTOR;
+  size_t last = (start + cnt - 1) / BITS_PER_SECTOR;
+  if (cnt > 0)
+    bitmap_set_multiple (dirty_map, first, last - first + 1, true);
+}
+
+/* Recomputes the free count of every block group from the
+   free map. */
+static void
+count_groups (void)
+{
+  size_t g;
+  for (g = 0; g < group_cnt; g++)
+    {
+      size_t start = g * GROUP_SIZE;
+      size_t end = start + GROUP_SIZE;
+      if (end > bitmap_size (free_map))
+        end = bitmap_size (free_map);
+      group_free[g] = bitmap_count (free_map, start, end - start, false);
+    }
+}
+
+/* Sets the CNT free map bits starting at START to VALUE, which
+   they must not already have, and updates the block group counts
+   and dirty_map to match. */
+static void
+set_sectors (size_t start, size_t cnt, bool value)
+{
+  size_t i;
+  bitmap_set_multiple (free_map, start, cnt, value);
+  for (i = start; i < start + cnt; i++)
+    {
+      if (value)
+        group_free[i / GROUP_SIZE]--;
+      else
+        group_free[i / GROUP_SIZE]++;
+    }
+  mark_dirty (start, cnt);
+}
+
+/* Returns the first sector at or after START, and before END,
+   that begins a run of CNT free sectors, or BITMAP_ERROR if there
+   is none.  The run may reach past END. */
+static size_t
+scan_group (size_t start, size_t end, size_t cnt)
+{
+  size_t i;
+  for (i = start; i < end && i + cnt <= bitmap_size (free_map); i++)
+    {
+      scan_cnt++;
+      if (!bitmap_test (free_map, i)
+          && !bitmap_contains (free_map, i, cnt, true))
+        return i;
+    }
+  return BITMAP_ERROR;
+}
+
+/* Finds CNT consecutive free sectors as close after HINT as the
+   free map allows and returns the first, or BITMAP_ERROR.  The
+   search runs from HINT to the end of its block group, then
+   through the following groups, wrapping around to the start of
+   HINT's group, and skips groups that have no free sectors.  The
+   sectors are not marked as used. */
+static size_t
+find_near (size_t cnt, block_sector_t hint)
+{
+  size_t g0, i;
+
+  if (hint >= bitmap_size (free_map))
+    hint = 0;
+  g0 = hint / GROUP_SIZE;
+  for (i = 0; i <= group_cnt; i++)
+    {
+      size_t g = (g0 + i) % group_cnt;
+      size_t start = i == 0 ? hint : g * GROUP_SIZE;
+      size_t end = i == group_cnt ? hint : g * GROUP_SIZE + GROUP_SIZE;
+      size_t sector;
+
+      if (group_free[g] == 0)
+        continue;
+      sector = scan_group (start, end, cnt);
+      if (sector != BITMAP_ERROR)
+        return sector;
+    }
+  return BITMAP_ERROR;
+}
+
+/* Writes the sectors of the free map file marked by mark_dirty(),
+   or just notes that they have to be written if free_map_defer()
+   is in effect.  Consecutive dirty sectors go out in one write.
+   Returns false if a write failed. */
+static bool
+free_map_sync (void)
+{
+  size_t start, end;
+  bool success = true;
+
+  if (free_map_file == NULL)
+    return true;
+  if (defer_depth > 0)
+    {
+      deferred_write = true;
+      return true;
+    }
+
+  write_cnt++;
+  start = 0;
+  while ((start = bitmap_scan (dirty_map, start, 1, true)) != BITMAP_ERROR)
+    {
+      end = bitmap_scan (dirty_map, start, 1, false);
+      if (end == BITMAP_ERROR)
+        end = bitmap_size (dirty_map);
+      if (!bitmap_write_part (free_map, free_map_file,
+                              start * BLOCK_SECTOR_SIZE,
+                              (end - start) * BLOCK_SECTOR_SIZE))
+        success = false;
+      bitmap_set_multiple (dirty_map, start, end - start, false);
+      sector_write_cnt += end - start;
+      start = end;
+    }
+  return success;
+}
+
+/* Acquires free_map_lock unless the running thread already holds
+   it, as it does within free_map_defer().  Returns true if the
+   lock was acquired here and so must be released with
+   unlock_free_map(). */
+static bool
+lock_free_map (void)
+{
+  if (lock_held_by_current_thread (&free_map_lock))
+    return false;
+  lock_acquire (&free_map_lock);
+  return true;
+}
+
+/* Releases free_map_lock if LOCKED, the value lock_free_map()
+   returned. */
+static void
+unlock_free_map (bool locked)
+{
+  if (locked)
+    lock_release (&free_map_lock);
+}
 
 /* Initializes the free map. */
 void
 free_map_init (void)
 {
+  lock_init (&free_map_lock);
   free_map = bitmap_create (block_size (fs_device));
   if (free_map == NULL)
     PANIC ("bitmap creation failed--file system device is too large");
   bitmap_mark (free_map, FREE_MAP_SECTOR);
   bitmap_mark (free_map, ROOT_DIR_SECTOR);
+  bitmap_set_multiple (free_map, JOURNAL_SECTOR, JOURNAL_SECTORS, true);
+  dirty_map = bitmap_create (DIV_ROUND_UP (bitmap_file_size (free_map),
+                                           BLOCK_SECTOR_SIZE));
+  group_cnt = DIV_ROUND_UP (bitmap_size (free_map), GROUP_SIZE);
+  group_free = malloc (group_cnt * sizeof *group_free);
+  if (dirty_map == NULL || group_free == NULL)
+    PANIC ("bitmap creation failed--file system device is too large");
+  count_groups ();
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
@@ -27,16 +213,37 @@ free_map_init (void)
 bool
 free_map_allocate (size_t cnt, block_sector_t *sectorp)
 {
-  block_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
-  if (sector != BITMAP_ERROR
-      && free_map_file != NULL
-      && !bitmap_write (free_map, free_map_file))
+  return free_map_allocate_near (cnt, 0, sectorp);
+}
+
+/* Like free_map_allocate(), but takes the first run of CNT free
+   sectors found at or after HINT, going on to the following
+   block groups if HINT's group has none, so that related sectors
+   end up close together on disk.  If the disk looks full, removed
+   files still waiting for the reclaimer are freed first. */
+bool
+free_map_allocate_near (size_t cnt, block_sector_t hint,
+                        block_sector_t *sectorp)
+{
+  bool locked = lock_free_map ();
+  block_sector_t sector;
+
+  while ((sector = find_near (cnt, hint)) == BITMAP_ERROR
+         && inode_reclaim_held ())
+    continue;
+  if (sector != BITMAP_ERROR)
+    set_sectors (sector, cnt, true);
+  if (sector != BITMAP_ERROR && !free_map_sync ())
     {
-      bitmap_set_multiple (free_map, sector, cnt, false);
+      set_sectors (sector, cnt, false);
       sector = BITMAP_ERROR;
     }
   if (sector != BITMAP_ERROR)
-    *sectorp = sector;
+    {
+      *sectorp = sector;
+      alloc_cnt++;
+    }
+  unlock_free_map (locked);
   return sector != BITMAP_ERROR;
 }
 
@@ -44,9 +251,149 @@ free_map_allocate (size_t cnt, block_sector_t *sectorp)
 void
 free_map_release (block_sector_t sector, size_t cnt)
 {
+  bool locked = lock_free_map ();
   ASSERT (bitmap_all (free_map, sector, cnt));
-  bitmap_set_multiple (free_map, sector, cnt, false);
-  bitmap_write (free_map, free_map_file);
+  set_sectors (sector, cnt, false);
+  free_map_sync ();
+  unlock_free_map (locked);
+}
+
+/* Allocates CNT sectors, storing them into SECTORS[] in order.
+   They are taken as runs that are as long as the free map
+   allows, starting with one run of CNT, so consecutive entries
+   are mostly consecutive sectors.  Each run is looked for after
+   the previous one, the first after HINT.  The free map is
+   scanned once per run and written once in all.
+   Returns true if successful, false if fewer than CNT sectors
+   were free, in which case none are allocated. */
+bool
+free_map_allocate_multiple (size_t cnt, block_sector_t hint,
+                            block_sector_t *sectors)
+{
+  bool locked = lock_free_map ();
+  bool success = false;
+  size_t got = 0;
+  size_t run = cnt;
+
+  while (got < cnt)
+    {
+      block_sector_t start;
+      size_t i;
+
+      if (run > cnt - got)
+        run = cnt - got;
+      start = find_near (run, hint);
+      if (start == BITMAP_ERROR)
+        {
+          if (run > 1)
+            {
+              run /= 2;
+              continue;
+            }
+          if (inode_reclaim_held ())
+            continue;
+          for (i = 0; i < got; i++)
+            set_sectors (sectors[i], 1, false);
+          goto done;
+        }
+      set_sectors (start, run, true);
+      for (i = 0; i < run; i++)
+        sectors[got++] = start + i;
+      hint = start + run;
+    }
+
+  if (cnt > 0 && !free_map_sync ())
+    {
+      for (got = 0; got < cnt; got++)
+        set_sectors (sectors[got], 1, false);
+      goto done;
+    }
+  if (cnt > 0)
+    alloc_cnt++;
+  success = true;
+
+ done:
+  unlock_free_map (locked);
+  return success;
+}
+
+/* Holds back writes of the free map to disk until the matching
+   free_map_commit(), so that an operation that allocates or
+   releases many sectors writes the free map once.  Calls nest.
+   The free map stays locked to the running thread until the
+   outermost free_map_commit().  A thread that already holds the
+   free map, such as an allocator that frees removed files to
+   make room, keeps holding it after that commit. */
+void
+free_map_defer (void)
+{
+  bool locked = lock_free_map ();
+  if (defer_depth++ == 0)
+    defer_locked = locked;
+}
+
+/* Ends a free_map_defer().  The free map is written if it
+   changed and no other deferral is still open. */
+void
+free_map_commit (void)
+{
+  ASSERT (lock_held_by_current_thread (&free_map_lock));
+  ASSERT (defer_depth > 0);
+  if (--defer_depth == 0)
+    {
+      if (deferred_write)
+        {
+          deferred_write = false;
+          free_map_sync ();
+        }
+      if (defer_locked)
+        {
+          defer_locked = false;
+          lock_release (&free_map_lock);
+        }
+    }
+}
+
+/* Returns the number of times the free map has been written to
+   its file. */
+unsigned
+free_map_write_cnt (void)
+{
+  return write_cnt;
+}
+
+/* Returns the number of free map file sectors written so far. */
+unsigned
+free_map_sector_write_cnt (void)
+{
+  return sector_write_cnt;
+}
+
+/* Returns the number of successful allocations so far. */
+unsigned
+free_map_alloc_cnt (void)
+{
+  return alloc_cnt;
+}
+
+/* Returns the number of free map bits allocations have examined
+   so far. */
+unsigned
+free_map_scan_cnt (void)
+{
+  return scan_cnt;
+}
+
+/* Returns the number of sectors currently free. */
+unsigned
+free_map_free_cnt (void)
+{
+  size_t free_cnt = 0;
+  size_t i;
+
+  for (i = 0; i < group_cnt; i++)
+    free_cnt += group_free[i];
+  return free_cnt;
 }
 
 /* Opens the free map file and reads it from disk. */
@@ -56,8 +403,10 @@ free_map_open (void)
   free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
   if (free_map_file == NULL)
     PANIC ("can't open free map");
+  inode_set_metadata (file_get_inode (free_map_file));
   if (!bitmap_read (free_map, free_map_file))
     PANIC ("can't read free map");
+  count_groups ();
 }
 
 /* Writes the free map to disk and closes the free map file. */
@@ -73,13 +422,14 @@ void
 free_map_create (void)
 {
   /* Create inode. */
-  if (!inode_create (FREE_MAP_SECTOR, bitmap_file_size (free_map)))
+  if (!inode_create_full (FREE_MAP_SECTOR, bitmap_file_size (free_map)))
     PANIC ("free map creation failed");
 
   /* Write bitmap to file. */
   free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
   if (free_map_file == NULL)
     PANIC ("can't open free map");
+  inode_set_metadata (file_get_inode (free_map_file));
   if (!bitmap_write (free_map, free_map_file))
     PANIC ("can't write free map");
 }
@@ -12,6 +12,16 @@ void free_map_open (void);
 void free_map_close (void);
 
 bool free_map_allocate (size_t, block_sector_t *);
+bool free_map_allocate_near (size_t, block_sector_t hint, block_sector_t *);
+bool free_map_allocate_multiple (size_t, block_sector_t hint,
+                                 block_sector_t *);
 void free_map_release (block_sector_t, size_t);
+void free_map_defer (void);
+void free_map_commit (void);
+unsigned free_map_write_cnt (void);
+unsigned free_map_sector_write_cnt (void);
+unsigned free_map_alloc_cnt (void);
+unsigned free_map_scan_cnt (void);
+unsigned free_map_free_cnt (void);
 
 #endif /* filesys/free-map.h */
@@ -2,17 +2,149 @@
 #include <list.h>
 #include <debug.h>
 #include <round.h>
+#include <stdlib.h>
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "filesys/journal.h"
 #include "threads/malloc.h"
 #include "devices/block.h"
-
+#include "devices/timer.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+
+/* Buffer cache slots and their data, one sector per slot.
+   Controlled by kernel command-line option "-cache=N". */
+struct cached_block *Cache;
+size_t cache_size = CACHE_DEFAULT_SIZE;
+static uint8_t *cache_data;
+
+/* Replacement policy.  Controlled by kernel command-line option
+   "-cache-policy=NAME". */
+enum cache_policy cache_policy = CACHE_CLOCK;
+
+/* 2Q state, under cache_lock.  A sector enters A1 when it is
+   read in and leaves it, oldest first, when A1 holds more than
+   a quarter of the cache, so that one pass over a large file
+   cannot push out blocks in use.  A sector evicted from A1 is
+   remembered in the ghost ring for a while; if it is missed
+   again before it is forgotten, it goes straight into Am, as do
+   metadata sectors as soon as they are used as such.  Am is
+   swept by the clock hand. */
+static struct list a1_list;             /* A1 slots, oldest first. */
+static block_sector_t *ghost;           /* Sectors evicted from A1. */
+static size_t ghost_size;               /* Capacity of ghost. */
+static size_t ghost_cnt;                /* Sectors in ghost. */
+static size_t ghost_next;               /* Where the next one goes. */
+
+/* Clock sweeps that a metadata block survives without being used,
+   under 2Q, against one for a file data block. */
+#define CACHE_META_CHANCES 3
 
 int hand;
 static char zeros[BLOCK_SECTOR_SIZE];
 static int hits;
 static int misses;
+static unsigned flushes;
+static unsigned sync_writes;
+static unsigned stalls_avoided;
+
+/* Ticks between two passes of the write-behind flusher, which
+   bounds how long a dirty block can sit only in memory. */
+#define FLUSH_INTERVAL (5 * TIMER_FREQ)
+
+/* Serializes write-back passes.  cache_done() keeps it so the
+   flusher never touches the cache once it has been torn down. */
+static struct lock flush_lock;
+
+/* Upped by cache_tick() once every FLUSH_INTERVAL, so that the
+   flusher blocks between passes instead of polling the clock. */
+static struct semaphore flush_due;
+static bool flush_due_ready;            /* flush_due initialized? */
+
+/* A dirty slot picked up by cache_write_back(). */
+struct flush_entry
+  {
+    block_sector_t sector;              /* Sector the slot held. */
+    int cache_idx;                      /* Index into Cache[]. */
+  };
+static struct flush_entry *flush_order;
+
+/* Most dirty sectors written back in one device request. */
+#define CACHE_RUN_MAX 32
+
+/* Protects the owner and dirty_elem members of every cached
+   block and the dirty_blocks list of every open inode.  Taken
+   with a block's lock held, or alone, and nothing is acquired
+   while holding it. */
+static struct lock dirty_lock;
+
+/* journal_overflow_cnt() as of the last inode_sync() that wrote
+   the whole cache back because of it. */
+static unsigned synced_overflows;
+
+/* Sectors queued for the read-ahead thread.  Requests that do not
+   fit are dropped, since read-ahead is only a hint. */
+#define RA_QUEUE_SIZE 64
+static block_sector_t ra_queue[RA_QUEUE_SIZE];
+static int ra_head;                     /* Next sector to prefetch. */
+static int ra_cnt;                      /* Sectors in ra_queue. */
+static struct lock ra_queue_lock;       /* Protects ra_queue. */
+static struct condition ra_queue_nonempty;
+
+/* Held by the read-ahead thread while it fills a slot.
+   cache_done() keeps it, like flush_lock. */
+static struct lock ra_lock;
+static unsigned readaheads;
+static unsigned direct_reads;
+static unsigned direct_writes;
+
+/* Maps a sector number to the Cache[] slot holding it, so that
+   lookups do not have to scan every slot.  Only valid slots are
+   in the index. */
+static struct hash cache_index;
+static unsigned index_lookups;          /* Searches of cache_index. */
+static unsigned index_compares;         /* Sector comparisons made by
+                                           searches and inserts. */
+
+/* Protects cache_index, the identity (valid, sector) of every
+   slot, the clock hand and the hit/miss counters.  It is never
+   held across disk I/O; the per-slot cache_block_lock is what
+   guards a slot's data while it is read, written or filled. */
+static struct lock cache_lock;
+
+static unsigned cache_index_hash (const struct hash_elem *, void *);
+static bool cache_index_less (const struct hash_elem *,
+                              const struct hash_elem *, void *);
+static void cache_index_insert (int cache_idx);
+static void cache_set_meta (int cache_idx, bool meta);
+static void cache_write_run (const int *run, size_t n);
+static void cache_write_back (void);
+static void cache_set_owner (int cache_idx, struct inode *inode);
+static void cache_claim (block_sector_t sector, struct inode *inode);
+static unsigned cache_write_entries (int cnt);
+static void cache_disown (struct inode *inode);
+static void cache_sync_inode (struct inode *inode);
+static int cache_lookup_locked (block_sector_t sector);
+static void cache_index_remove (int cache_idx);
+static off_t inode_read (struct inode *, const struct iovec *, int iovcnt,
+                         off_t offset, bool direct);
+static off_t inode_write (struct inode *, const struct iovec *, int iovcnt,
+                          off_t offset, bool direct);
+
+bool inode_use_extents;
+
+/* Most sectors extent_resize() allocates ahead of the end of a
+   growing file. */
+#define EXTENT_PREALLOC_MAX 64
+
+static bool extent_resize (struct inode_disk *, off_t size,
+                           block_sector_t hint);
+static void extent_trim (struct inode_disk *);
+static block_sector_t extent_to_sector (const struct inode_disk *,
+                                        size_t file_block);
 
 int min(int a, int b){
   if (a<b)return a;
@@ -27,66 +159,366 @@ bytes_to_sectors (off_t size)
   return DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE);
 }
 
+/* No block is copied into an inode's map_leaf. */
+#define MAP_NONE ((block_sector_t) -1)
+
+/* Forgets INODE's copies of its indirect blocks.  Must be called
+   whenever the tree changes, with INODE's lock held for writing. */
+static void
+inode_map_invalidate (struct inode *inode)
+{
+  inode->map_top_valid = false;
+  inode->map_leaf_sector = MAP_NONE;
+  inode->map_mid_idx = -1;
+}
+
+/* Returns entry IDX of indirect block SECTOR, copying the block
+   into INODE's map_leaf first if it is not already there.  Must
+   be called with INODE's map_lock held. */
+static block_sector_t
+map_leaf_lookup (struct inode *inode, block_sector_t sector, int idx)
+{
+  if (sector == 0)
+    return 0;
+  if (inode->map_leaf_sector != sector)
+    {
+      cached_read (sector, 0, inode->map_leaf, BLOCK_SECTOR_SIZE);
+      inode->map_leaf_sector = sector;
+    }
+  return inode->map_leaf[idx];
+}
+
 /* Returns the block device sector that contains byte offset POS
    within INODE.
-   Returns -1 if INODE does not contain data for a byte at offset
-   POS. */
+   Returns 0 if POS falls in a hole that has never been written.
+
+   Sequential access stays inside one indirect block for 128
+   sectors at a time, so the last indirect block used, the doubly
+   indirect block and the last block used under the triply
+   indirect block are kept in INODE and only go back to the
+   buffer cache when the reader moves to another block. */
 static block_sector_t
-byte_to_sector (const struct inode *inode, off_t pos)
+byte_to_sector (struct inode *inode, off_t pos)
 {
   ASSERT (inode != NULL);
   ASSERT (pos   >= 0);
 
   int block_num = pos / BLOCK_SECTOR_SIZE;
+  block_sector_t sector;
+  if (inode->data.flags & INODE_EXTENTS)
+    return extent_to_sector (&inode->data, block_num);
   if (block_num < 112)
     return inode->data.direct[block_num];
-  else if (block_num<112 + 128){
-    block_sector_t sector;
-    cached_read(inode->data.indirect, (block_num - 112)*4, &sector, 4);
-    return sector;    
+
+  lock_acquire (&inode->map_lock);
+  if (block_num<112 + 128)
+    sector = map_leaf_lookup (inode, inode->data.indirect, block_num - 112);
+  else if (block_num >= INODE_TRIPLY_START) {
+    int idx_1 = (block_num - INODE_TRIPLY_START) / (128 * 128);
+    int idx_2 = (block_num - INODE_TRIPLY_START) / 128 % 128;
+    int idx_3 = (block_num - INODE_TRIPLY_START) % 128;
+    if (inode->data.triply_indirect == 0)
+      sector = 0;
+    else {
+      if (inode->map_mid_idx != idx_1){
+        block_sector_t mid = 0;
+        cached_read (inode->data.triply_indirect, idx_1 * sizeof mid, &mid,
+                     sizeof mid);
+        if (mid == 0)
+          memset (inode->map_mid, 0, BLOCK_SECTOR_SIZE);
+        else
+          cached_read (mid, 0, inode->map_mid, BLOCK_SECTOR_SIZE);
+        inode->map_mid_idx = idx_1;
+      }
+      sector = map_leaf_lookup (inode, inode->map_mid[idx_2], idx_3);
+    }
   }
   else {
-    block_sector_t sector1,sector2;
     int idx_1 = (block_num - 112 - 128) / 128;
     int idx_2 = (block_num - 112 - 128) % 128;
-    cached_read(inode->data.doubly_indirect, idx_1*4, &sector1, 4);
-    cached_read(sector1, idx_2*4, &sector2, 4);    
-    return sector2;
+    if (inode->data.doubly_indirect == 0)
+      sector = 0;
+    else {
+      if (!inode->map_top_valid){
+        cached_read (inode->data.doubly_indirect, 0, inode->map_top,
+                     BLOCK_SECTOR_SIZE);
+        inode->map_top_valid = true;
+      }
+      sector = map_leaf_lookup (inode, inode->map_top[idx_1], idx_2);
+    }
   }
-  return 0;
+  lock_release (&inode->map_lock);
+  return sector;
+}
+
+/* Allocates a sector near HINT into *SECTOR, unless *SECTOR
+   already holds one.  A new sector is zeroed if ZERO is true.
+   Returns false if the disk is full. */
+static bool
+allocate_sector (block_sector_t *sector, block_sector_t hint, bool zero)
+{
+  if (*sector != 0)
+    return true;
+  if (!free_map_allocate_near (1, hint, sector))
+    {
+      *sector = 0;
+      return false;
+    }
+  if (zero)
+    cached_write (*sector, 0, zeros, BLOCK_SECTOR_SIZE);
+  return true;
+}
+
+/* Returns entry IDX of indirect block BLOCK, first allocating a
+   sector near HINT for it if the entry is empty.  The new sector
+   is zeroed if ZERO is true.  Returns 0 if the disk is full. */
+static block_sector_t
+allocate_entry (block_sector_t block, int idx, block_sector_t hint, bool zero)
+{
+  block_sector_t sector = 0;
+
+  cached_read (block, idx * sizeof sector, &sector, sizeof sector);
+  if (sector == 0)
+    {
+      if (!allocate_sector (&sector, hint, zero))
+        return 0;
+      cached_write_meta (block, idx * sizeof sector, &sector, sizeof sector);
+    }
+  return sector;
+}
+
+/* Returns the sector that holds byte offset POS of tree-format
+   INODE, allocating it near HINT, along with any indirect blocks
+   on the way to it, if POS is in a hole.  The data sector is
+   zeroed only if ZERO is true, so a caller about to overwrite all
+   of it can skip that.  Returns 0 if the disk is full.  Must be
+   called with INODE's lock held for writing. */
+static block_sector_t
+tree_allocate (struct inode *inode, off_t pos, block_sector_t hint, bool zero)
+{
+  struct inode_disk *id = &inode->data;
+  int block_num = pos / BLOCK_SECTOR_SIZE;
+  block_sector_t mid, leaf;
+
+  ASSERT (!(id->flags & INODE_EXTENTS));
+
+  inode_map_invalidate (inode);
+  if (block_num < 112)
+    return allocate_sector (&id->direct[block_num], hint, zero)
+           ? id->direct[block_num] : 0;
+  block_num -= 112;
+  if (block_num < 128)
+    {
+      if (!allocate_sector (&id->indirect, hint, true))
+        return 0;
+      return allocate_entry (id->indirect, block_num, hint, zero);
+    }
+  block_num -= 128;
+  if (block_num < 128 * 128)
+    {
+      if (!allocate_sector (&id->doubly_indirect, hint, true))
+        return 0;
+      leaf = allocate_entry (id->doubly_indirect, block_num / 128, hint,
+                             true);
+      if (leaf == 0)
+        return 0;
+      return allocate_entry (leaf, block_num % 128, hint, zero);
+    }
+  block_num -= 128 * 128;
+  if (!allocate_sector (&id->triply_indirect, hint, true))
+    return 0;
+  mid = allocate_entry (id->triply_indirect, block_num / (128 * 128), hint,
+                        true);
+  if (mid == 0)
+    return 0;
+  leaf = allocate_entry (mid, block_num / 128 % 128, hint, true);
+  if (leaf == 0)
+    return 0;
+  return allocate_entry (leaf, block_num % 128, hint, zero);
+}
+
+/* Open inodes, hashed by sector, so that opening a single inode
+   twice returns the same `struct inode'. */
+static struct hash open_inodes;
+
+/* Protects open_inodes and every open inode's open_cnt and
+   loading. */
+static struct lock open_inodes_lock;
+
+/* A removed inode whose sectors the reclaimer has yet to free. */
+struct reclaim
+  {
+    struct list_elem elem;              /* Element in reclaim_list. */
+    block_sector_t sector;              /* The inode's own sector. */
+    struct inode_disk data;             /* Its contents when closed. */
+  };
+
+/* Removed inodes waiting for the reclaimer, oldest first. */
+static struct list reclaim_list;
+static struct lock reclaim_lock;        /* Protects reclaim_list. */
+static struct condition reclaim_ready;  /* Signaled when it gains one. */
+static unsigned reclaims_queued;        /* Inodes added to reclaim_list. */
+
+static void reclaim_enqueue (block_sector_t, const struct inode_disk *);
+
+static unsigned
+open_inode_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct inode *inode = hash_entry (e, struct inode, elem);
+  return hash_int (inode->sector);
 }
 
-/* List of open inodes, so that opening a single inode twice
-   returns the same `struct inode'. */
-static struct list open_inodes;
+static bool
+open_inode_less (const struct hash_elem *a_, const struct hash_elem *b_,
+                 void *aux UNUSED)
+{
+  const struct inode *a = hash_entry (a_, struct inode, elem);
+  const struct inode *b = hash_entry (b_, struct inode, elem);
+  return a->sector < b->sector;
+}
 
 /* Initializes the inode module. */
 void
 inode_init (void)
 {
-  list_init (&open_inodes);
+  if (!hash_init (&open_inodes, open_inode_hash, open_inode_less, NULL))
+    PANIC ("can't allocate open inode table");
+  lock_init (&open_inodes_lock);
+  list_init (&reclaim_list);
+  lock_init (&reclaim_lock);
+  cond_init (&reclaim_ready);
+}
+
+// number of pages backing the slot array and the slot data
+static size_t cache_slot_pages (void){
+  return DIV_ROUND_UP (cache_size * sizeof *Cache, PGSIZE);
+}
+static size_t cache_data_pages (void){
+  return DIV_ROUND_UP (cache_size, PGSIZE / BLOCK_SECTOR_SIZE);
 }
 
 void cache_init (void)
 {
   hand = 0;
   int i =0; 
+  if (cache_size == 0)
+    PANIC ("buffer cache needs at least one slot");
+  Cache = palloc_get_multiple (PAL_ZERO, cache_slot_pages ());
+  cache_data = palloc_get_multiple (0, cache_data_pages ());
+  if (Cache == NULL || cache_data == NULL)
+    PANIC ("can't allocate a %zu block buffer cache", cache_size);
   for (i=0;i<CACHE_SIZE;i++){
     Cache[i].valid = 0;
     Cache[i].dirty = 0;
+    Cache[i].flushed = 0;
+    Cache[i].journaled = 0;
+    Cache[i].meta = 0;
+    Cache[i].queue = CACHE_AM;
+    Cache[i].owner = NULL;
     Cache[i].clock = 0;
     Cache[i].sector= 0;
-    Cache[i].data = (uint8_t*)malloc (BLOCK_SECTOR_SIZE);
+    Cache[i].data = cache_data + i * BLOCK_SECTOR_SIZE;
     lock_init (&(Cache[i].cache_block_lock));
   }
+  if (!hash_init (&cache_index, cache_index_hash, cache_index_less, NULL))
+    PANIC ("buffer cache index creation failed");
+  lock_init (&cache_lock);
+  lock_init (&flush_lock);
+  sema_init (&flush_due, 0);
+  flush_due_ready = true;
+  lock_init (&ra_lock);
+  lock_init (&ra_queue_lock);
+  cond_init (&ra_queue_nonempty);
+  flush_order = malloc (cache_size * sizeof *flush_order);
+  if (flush_order == NULL)
+    PANIC ("can't allocate buffer cache flush list");
+  list_init (&a1_list);
+  lock_init (&dirty_lock);
+  ghost_size = cache_size / 2 > 0 ? cache_size / 2 : 1;
+  ghost = malloc (ghost_size * sizeof *ghost);
+  if (ghost == NULL)
+    PANIC ("can't allocate buffer cache ghost list");
   memset (zeros, 0, BLOCK_SECTOR_SIZE);
   return;
 }
 
-bool inode_create (block_sector_t sector, off_t length){
+// write every dirty block back and release the cache's memory
+void cache_done (void)
+{
+  lock_acquire (&flush_lock);
+  lock_acquire (&ra_lock);
+  cache_write_back ();
+  free (flush_order);
+  free (ghost);
+  hash_destroy (&cache_index, NULL);
+  palloc_free_multiple (cache_data, cache_data_pages ());
+  palloc_free_multiple (Cache, cache_slot_pages ());
+}
+
+// zero the CNT sectors in SECTORS with one batched cache write
+static bool zero_sectors (const block_sector_t *sectors, size_t cnt){
+  struct cache_io *ios = malloc (cnt * sizeof *ios);
+  size_t i;
+  if (ios == NULL)
+    return false;
+  for (i = 0; i < cnt; i++){
+    ios[i].sector = sectors[i];
+    ios[i].ofs = 0;
+    ios[i].buffer = zeros;
+    ios[i].size = BLOCK_SECTOR_SIZE;
+  }
+  cached_write_many (ios, cnt);
+  free (ios);
+  return true;
+}
+
+// zero the first CNT data sectors of tree-format ID, which may
+// reach no further than its doubly indirect block.  the pointer
+// blocks naming them are read in one batch too.
+static bool zero_tree (const struct inode_disk *id, size_t cnt){
+  block_sector_t *sectors = malloc (cnt * sizeof *sectors);
+  struct cache_io *ios = malloc ((DIV_ROUND_UP (cnt, 128) + 1) * sizeof *ios);
+  block_sector_t *leaves = malloc (BLOCK_SECTOR_SIZE);
+  size_t i, io_cnt = 0;
+  bool success = sectors != NULL && ios != NULL && leaves != NULL;
+
+  ASSERT (cnt <= INODE_TRIPLY_START);
+  if (success){
+    memcpy (sectors, id->direct, min (cnt, 112) * sizeof *sectors);
+    if (cnt > 112){
+      ios[io_cnt].sector = id->indirect;
+      ios[io_cnt].ofs = 0;
+      ios[io_cnt].buffer = sectors + 112;
+      ios[io_cnt].size = min (cnt - 112, 128) * sizeof *sectors;
+      io_cnt++;
+    }
+    if (cnt > 112 + 128){
+      cached_read (id->doubly_indirect, 0, leaves, BLOCK_SECTOR_SIZE);
+      for (i = 112 + 128; i < cnt; i += 128){
+        ios[io_cnt].sector = leaves[(i - 112 - 128) / 128];
+        ios[io_cnt].ofs = 0;
+        ios[io_cnt].buffer = sectors + i;
+        ios[io_cnt].size = min (cnt - i, 128) * sizeof *sectors;
+        io_cnt++;
+      }
+    }
+    cached_read_many (ios, io_cnt);
+    success = zero_sectors (sectors, cnt);
+  }
+  free (leaves);
+  free (ios);
+  free (sectors);
+  return success;
+}
+
+// write a new LENGTH byte inode to SECTOR.  a SPARSE tree-format
+// inode gets no data sectors; they are allocated as they are first
+// written, and until then read back as zeros.  one small enough
+// keeps its data in its own sector until it grows.
+static bool create_inode (block_sector_t sector, off_t length, bool sparse){
   struct inode_disk *disk_inode = NULL;
   bool success = false;
-  int i,j;
+  int i;
   ASSERT (length >= 0);
 
   /* If this assertion fails, the inode structure is not exactly
@@ -101,44 +533,67 @@ bool inode_create (block_sector_t sector, off_t length){
       disk_inode->length = length;
       disk_inode->magic  = INODE_MAGIC;
 
+      if (inode_use_extents)
+        {
+          disk_inode->flags = INODE_EXTENTS;
+          disk_inode->length = 0;
+          if (inode_resize_near (disk_inode, length, sector))
+            {
+              block_sector_t *sectors = malloc (block_num * sizeof *sectors);
+              cached_write_meta (sector, 0, disk_inode, BLOCK_SECTOR_SIZE);
+              if (sectors != NULL)
+                {
+                  for (i = 0; i < block_num; i++)
+                    sectors[i] = extent_to_sector (disk_inode, i);
+                  success = zero_sectors (sectors, block_num);
+                }
+              free (sectors);
+            }
+          free (disk_inode);
+          return success;
+        }
+
       for (i=0;i<112;i++)disk_inode->direct[i]=0;
       disk_inode->indirect = 0;
       disk_inode->doubly_indirect = 0;
 
-      if (block_num>=0 && create_data_block(block_num,disk_inode)){
-        cached_write(sector, 0, disk_inode, BLOCK_SECTOR_SIZE);        
-        for (i = 0; i < min(112, block_num); i++) {
-          cached_write(disk_inode->direct[i], 0, zeros, BLOCK_SECTOR_SIZE);
-        }
-        if (block_num > 112){
-          block_sector_t* indirect_buffer = malloc(BLOCK_SECTOR_SIZE);
-          cached_read(disk_inode->indirect,0,indirect_buffer,BLOCK_SECTOR_SIZE);
-          for (i = 0; i < min(128,block_num-112); i++){
-            cached_write (indirect_buffer[i],0,zeros,BLOCK_SECTOR_SIZE);
-          }
-          free(indirect_buffer);
-        }
-        if (block_num > 112 + 128) {
-          block_sector_t* double_buffer = malloc(BLOCK_SECTOR_SIZE);
-          block_sector_t* indirect_buffer = malloc(BLOCK_SECTOR_SIZE);
-
-          cached_read(disk_inode->doubly_indirect,0,double_buffer,BLOCK_SECTOR_SIZE);
-          for (j=0; j< block_num - 112 - 128; j+=128) {
-            cached_read(double_buffer[j/128],0,indirect_buffer,BLOCK_SECTOR_SIZE);
-            for (i = 0; i < min(128,block_num - 112 -128 -j); i++) {
-              cached_write (indirect_buffer[i],0,zeros,BLOCK_SECTOR_SIZE);
-            }            
-          }
-          free(indirect_buffer);
-          free(double_buffer);
-        }
-        success = true;
+      if (sparse){
+        if (length <= INODE_INLINE_SIZE)
+          disk_inode->flags = INODE_INLINE;
+        cached_write_meta(sector, 0, disk_inode, BLOCK_SECTOR_SIZE);
+        free (disk_inode);
+        return true;
+      }
+
+      if (block_num>=0 && create_data_block(block_num,disk_inode,sector)){
+        cached_write_meta(sector, 0, disk_inode, BLOCK_SECTOR_SIZE);
+        success = zero_tree (disk_inode, block_num);
       }
       free (disk_inode);
     }
   return success;
 }
 
+/* Initializes an inode with LENGTH bytes of data and
+   writes the new inode to sector SECTOR on the file system
+   device.  Data sectors are allocated as they are written.
+   Returns true if successful.
+   Returns false if memory or disk allocation fails. */
+bool
+inode_create (block_sector_t sector, off_t length)
+{
+  return create_inode (sector, length, true);
+}
+
+/* Like inode_create(), but allocates and zeros every data sector
+   up front.  For files that must not allocate while they are
+   written, such as the free map. */
+bool
+inode_create_full (block_sector_t sector, off_t length)
+{
+  return create_inode (sector, length, false);
+}
+
 
 /* Reads an inode from SECTOR
    and returns a `struct inode' that contains it.
@@ -146,34 +601,58 @@ bool inode_create (block_sector_t sector, off_t length){
 struct inode *
 inode_open (block_sector_t sector)
 {
-  struct list_elem *e;
+  struct inode key;
+  struct hash_elem *e;
   struct inode *inode;
 
   /* Check whether this inode is already open. */
-  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-       e = list_next (e))
+  key.sector = sector;
+  lock_acquire (&open_inodes_lock);
+  e = hash_find (&open_inodes, &key.elem);
+  if (e != NULL)
     {
-      inode = list_entry (e, struct inode, elem);
-      if (inode->sector == sector)
-        {
-          inode_reopen (inode);
-          return inode;
-        }
+      inode = hash_entry (e, struct inode, elem);
+      inode->open_cnt++;
+      while (inode->loading)
+        cond_wait (&inode->loaded, &open_inodes_lock);
+      lock_release (&open_inodes_lock);
+      return inode;
     }
 
   /* Allocate memory. */
   inode = malloc (sizeof *inode);
   if (inode == NULL)
-    return NULL;
+    {
+      lock_release (&open_inodes_lock);
+      return NULL;
+    }
 
-  /* Initialize. */
-  list_push_front (&open_inodes, &inode->elem);
+  /* Initialize, and publish the inode marked as loading, so that
+     the lock is not held while its sector is read.  Anyone else
+     opening it meanwhile waits on the inode, not the lock. */
   inode->sector = sector;
+  inode->loading = true;
+  cond_init (&inode->loaded);
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
-  sema_init(&inode->sema, 1);
+  inode->map_dirty = false;
+  list_init (&inode->dirty_blocks);
+  inode->ra_next = 0;
+  inode->ra_end = 0;
+  inode->ra_window = 0;
+  rwlock_init (&inode->rw);
+  lock_init (&inode->ra_lock);
+  lock_init (&inode->map_lock);
+  inode_map_invalidate (inode);
+  hash_insert (&open_inodes, &inode->elem);
+  lock_release (&open_inodes_lock);
+
   cached_read (inode->sector,0, &inode->data,BLOCK_SECTOR_SIZE);
+  lock_acquire (&open_inodes_lock);
+  inode->loading = false;
+  cond_broadcast (&inode->loaded, &open_inodes_lock);
+  lock_release (&open_inodes_lock);
   return inode;
 }
 
@@ -182,7 +661,11 @@ struct inode *
 inode_reopen (struct inode *inode)
 {
   if (inode != NULL)
-    inode->open_cnt++;
+    {
+      lock_acquire (&open_inodes_lock);
+      inode->open_cnt++;
+      lock_release (&open_inodes_lock);
+    }
   return inode;
 }
 
@@ -203,36 +686,182 @@ inode_close (struct inode *inode)
   if (inode == NULL)
     return;
 
-  /* Release resources if this was the last opener. */
-  if (--inode->open_cnt == 0)
+  /* Most closes only drop a reference, and need no journal
+     operation. */
+  lock_acquire (&open_inodes_lock);
+  if (inode->open_cnt > 1)
+    {
+      inode->open_cnt--;
+      lock_release (&open_inodes_lock);
+      return;
+    }
+  lock_release (&open_inodes_lock);
+
+  /* Release resources if this was the last opener.  Someone may
+     have reopened INODE since it was checked, so look again. */
+  journal_begin ();
+  lock_acquire (&open_inodes_lock);
+  bool last = --inode->open_cnt == 0;
+  if (last)
+    {
+      /* Give back sectors preallocated past the end. */
+      if ((inode->data.flags & INODE_EXTENTS) && !inode->removed)
+        extent_trim (&inode->data);
+
+      /* Write INODE back before it can be opened afresh. */
+      cached_write_meta(inode->sector,0,&(inode->data),BLOCK_SECTOR_SIZE);
+      hash_delete (&open_inodes, &inode->elem);
+    }
+  lock_release (&open_inodes_lock);
+
+  if (last)
     {
-      /* Remove from inode list and release lock. */
-      list_remove (&inode->elem);
+      /* Its dirty blocks are left to the flusher. */
+      cache_disown (inode);
 
       /* Deallocate blocks if removed. */
       if (inode->removed)
-        {
-          int i=0;
-          while (inode->data.direct[i]!=0){
-            free_map_release (inode->data.direct[i], 1);
-            i++;
-          }
+        reclaim_enqueue (inode->sector, &inode->data);
+      free (inode);
+    }
+  journal_end ();
+}
 
-          block_sector_t* indirect_buffer = malloc(BLOCK_SECTOR_SIZE);
-          inode_close_indirect(inode->data.indirect,indirect_buffer);
+/* Frees SECTOR, the sector of a removed inode whose contents were
+   DATA, and every sector DATA points to. */
+static void
+release_blocks (block_sector_t sector, const struct inode_disk *data)
+{
+  free_map_defer ();
+  if (data->flags & INODE_EXTENTS)
+    {
+      uint32_t i;
+      for (i = 0; i < data->extent_cnt; i++)
+        free_map_release (data->extents[i].start, data->extents[i].length);
+    }
+  else if (!(data->flags & INODE_INLINE))
+    {
+      int i;
+      for (i=0;i<112;i++)
+        if (data->direct[i]!=0)
+          free_map_release (data->direct[i], 1);
+
+      /* One pointer block each for the indirect, doubly and
+         triply indirect levels. */
+      block_sector_t* buffers = malloc(3 * BLOCK_SECTOR_SIZE);
+      if (buffers == NULL)
+        PANIC ("can't allocate buffers to free inode %"PRDSNu, sector);
+      block_sector_t* indirect_buffer = buffers;
+      block_sector_t* double_buffer = buffers + 128;
+      block_sector_t* triple_buffer = buffers + 256;
+      inode_close_indirect(data->indirect,indirect_buffer);
+
+      if (data->doubly_indirect!=0){
+        cached_read(data->doubly_indirect, 0, double_buffer, BLOCK_SECTOR_SIZE);
+        inode_close_indirect_many(double_buffer,128,indirect_buffer);
+        free_map_release (data->doubly_indirect, 1);
+      }
 
-          if (inode->data.doubly_indirect!=0){
-            block_sector_t* double_buffer   = malloc(BLOCK_SECTOR_SIZE);
-            cached_read(inode->data.doubly_indirect, 0, double_buffer, BLOCK_SECTOR_SIZE);
-            for (i=0;i<128;i++){
-              inode_close_indirect(double_buffer[i],indirect_buffer);
-            }
-            free(double_buffer);
-          }
-          free(indirect_buffer);
+      if (data->triply_indirect!=0){
+        cached_read(data->triply_indirect, 0, triple_buffer, BLOCK_SECTOR_SIZE);
+        for (i=0;i<128;i++){
+          if (triple_buffer[i]==0)
+            continue;
+          cached_read(triple_buffer[i], 0, double_buffer, BLOCK_SECTOR_SIZE);
+          inode_close_indirect_many(double_buffer,128,indirect_buffer);
+          free_map_release (triple_buffer[i], 1);
         }
-      cached_write(inode->sector,0,&(inode->data),BLOCK_SECTOR_SIZE);
-      free (inode);
+        free_map_release (data->triply_indirect, 1);
+      }
+      free(buffers);
+    }
+  free_map_release (sector, 1);
+  free_map_commit ();
+}
+
+/* Hands removed inode SECTOR, whose contents were DATA, to the
+   reclaimer thread, so that the last closer does not wait while
+   a large file's sectors are freed.  If memory is short, frees
+   them right away instead. */
+static void
+reclaim_enqueue (block_sector_t sector, const struct inode_disk *data)
+{
+  struct reclaim *r = malloc (sizeof *r);
+  if (r == NULL)
+    {
+      release_blocks (sector, data);
+      return;
+    }
+  r->sector = sector;
+  r->data = *data;
+  lock_acquire (&reclaim_lock);
+  list_push_back (&reclaim_list, &r->elem);
+  reclaims_queued++;
+  cond_signal (&reclaim_ready, &reclaim_lock);
+  lock_release (&reclaim_lock);
+}
+
+/* Frees the sectors of one removed inode that is waiting for the
+   reclaimer, in the running thread, as one journaled operation.
+   The caller must not hold the free map, since starting an
+   operation may wait for a commit.
+   Returns false if no inode was waiting. */
+bool
+inode_reclaim_one (void)
+{
+  bool reclaimed;
+
+  journal_begin ();
+  reclaimed = inode_reclaim_held ();
+  journal_end ();
+  return reclaimed;
+}
+
+/* Like inode_reclaim_one(), but for the free map allocators,
+   which call it with the free map held when the disk looks full.
+   It runs inside the caller's operation, if any, and never starts
+   one of its own.  The reclaimer thread does its work with the
+   free map locked too, so when an allocator holds the free map,
+   no inode is half reclaimed. */
+bool
+inode_reclaim_held (void)
+{
+  struct reclaim *r = NULL;
+
+  free_map_defer ();
+  lock_acquire (&reclaim_lock);
+  if (!list_empty (&reclaim_list))
+    r = list_entry (list_pop_front (&reclaim_list), struct reclaim, elem);
+  lock_release (&reclaim_lock);
+  if (r != NULL)
+    {
+      release_blocks (r->sector, &r->data);
+      free (r);
+    }
+  free_map_commit ();
+  return r != NULL;
+}
+
+/* Frees the sectors of every removed inode still waiting for the
+   reclaimer. */
+void
+inode_reclaim_all (void)
+{
+  while (inode_reclaim_one ())
+    continue;
+}
+
+/* Body of the reclaimer thread started by filesys_init(). */
+void
+inode_reclaimer (void *aux UNUSED)
+{
+  for (;;)
+    {
+      lock_acquire (&reclaim_lock);
+      while (list_empty (&reclaim_list))
+        cond_wait (&reclaim_ready, &reclaim_lock);
+      lock_release (&reclaim_lock);
+      inode_reclaim_one ();
     }
 }
 
@@ -241,10 +870,72 @@ inode_close (struct inode *inode)
 void
 inode_remove (struct inode *inode)
 {
-  sema_down (&inode->sema);
   ASSERT (inode != NULL);
+  rwlock_acquire_write (&inode->rw);
   inode->removed = true;
-  sema_up (&inode->sema);
+  rwlock_release_write (&inode->rw);
+}
+
+/* Queues SECTOR for the read-ahead thread. */
+static void
+readahead_enqueue (block_sector_t sector)
+{
+  lock_acquire (&ra_queue_lock);
+  if (ra_cnt < RA_QUEUE_SIZE)
+    {
+      ra_queue[(ra_head + ra_cnt) % RA_QUEUE_SIZE] = sector;
+      ra_cnt++;
+      cond_signal (&ra_queue_nonempty, &ra_queue_lock);
+    }
+  lock_release (&ra_queue_lock);
+}
+
+/* Updates INODE's read-ahead state for a read of SIZE bytes at
+   OFFSET and, if the read continues the previous one, queues the
+   sectors that follow it.  Each sequential read doubles the
+   window; any other read turns read-ahead off for INODE until
+   the next sequential read.  Readers share INODE's lock, so
+   the read-ahead state has a lock of its own. */
+static void
+inode_readahead (struct inode *inode, off_t size, off_t offset)
+{
+  int max_window = min (RA_MAX_WINDOW, CACHE_SIZE / 4);
+  size_t first, last;
+
+  lock_acquire (&inode->ra_lock);
+  if (offset == inode->ra_next)
+    inode->ra_window = min (inode->ra_window == 0
+                            ? RA_MIN_WINDOW : inode->ra_window * 2,
+                            max_window);
+  else
+    {
+      inode->ra_window = 0;
+      inode->ra_end = 0;
+    }
+  inode->ra_next = offset + size;
+  if (inode->ra_window <= 0)
+    {
+      lock_release (&inode->ra_lock);
+      return;
+    }
+
+  /* Sectors past the ones this read touches, clipped to the
+     file and to what has already been queued. */
+  first = DIV_ROUND_UP (offset + size, BLOCK_SECTOR_SIZE);
+  if (first < inode->ra_end)
+    first = inode->ra_end;
+  last = DIV_ROUND_UP (offset + size, BLOCK_SECTOR_SIZE) + inode->ra_window;
+  if (last > bytes_to_sectors (inode_length (inode)))
+    last = bytes_to_sectors (inode_length (inode));
+  for (; first < last; first++)
+    {
+      block_sector_t sector = byte_to_sector (inode, first * BLOCK_SECTOR_SIZE);
+      if (sector != 0)
+        readahead_enqueue (sector);
+    }
+  if (last > inode->ra_end)
+    inode->ra_end = last;
+  lock_release (&inode->ra_lock);
 }
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
@@ -253,9 +944,107 @@ inode_remove (struct inode *inode)
 off_t
 inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
 {
-  sema_down (&inode->sema);
-  uint8_t *buffer = buffer_;
+  struct iovec iov = { buffer_, size > 0 ? size : 0 };
+  return inode_read (inode, &iov, 1, offset, false);
+}
+
+/* Like inode_read_at(), but whole aligned sectors go straight
+   from the disk to BUFFER without passing through the buffer
+   cache.  Only partial sectors are read through the cache. */
+off_t
+inode_read_direct_at (struct inode *inode, void *buffer_, off_t size,
+                      off_t offset)
+{
+  struct iovec iov = { buffer_, size > 0 ? size : 0 };
+  return inode_read (inode, &iov, 1, offset, true);
+}
+
+/* Reads from INODE, starting at position OFFSET, into the IOVCNT
+   buffers in IOV, filling each in turn, and returns the number
+   of bytes actually read, which may be less than the buffers
+   hold if an error occurs or end of file is reached.  INODE is
+   locked once for the whole transfer.  If DIRECT is true, reads
+   whole sectors like inode_read_direct_at(). */
+off_t
+inode_readv_at (struct inode *inode, const struct iovec *iov, int iovcnt,
+                off_t offset, bool direct)
+{
+  return inode_read (inode, iov, iovcnt, offset, direct);
+}
+
+/* A place in an I/O vector: OFS bytes into buffer *IOV. */
+struct iov_pos
+  {
+    const struct iovec *iov;    /* Current buffer. */
+    size_t ofs;                 /* Bytes of it used so far. */
+  };
+
+/* Returns the total length of the IOVCNT buffers in IOV, but no
+   more than INODE_MAX_LENGTH. */
+static off_t
+iov_length (const struct iovec *iov, int iovcnt)
+{
+  size_t length = 0;
+  int i;
+
+  for (i = 0; i < iovcnt; i++)
+    {
+      if (iov[i].iov_len >= (size_t) INODE_MAX_LENGTH - length)
+        return INODE_MAX_LENGTH;
+      length += iov[i].iov_len;
+    }
+  return length;
+}
+
+/* Returns the next unused byte of the buffers at POS, and stores
+   into *LEFT how many bytes from there on are in the same buffer.
+   Buffers that are used up, or empty, are passed over, so there
+   must be at least one unused byte left. */
+static uint8_t *
+iov_next (struct iov_pos *pos, size_t *left)
+{
+  while (pos->ofs >= pos->iov->iov_len)
+    {
+      pos->iov++;
+      pos->ofs = 0;
+    }
+  *left = pos->iov->iov_len - pos->ofs;
+  return (uint8_t *) pos->iov->iov_base + pos->ofs;
+}
+
+static off_t
+inode_read (struct inode *inode, const struct iovec *iov, int iovcnt,
+            off_t offset, bool direct)
+{
+  struct iov_pos pos = { iov, 0 };
+  off_t size = iov_length (iov, iovcnt);
   off_t bytes_read = 0;
+  uint8_t *buffer;
+  size_t left;
+
+  rwlock_acquire_read (&inode->rw);
+  if (offset >= inode_length (inode))
+    size = 0;
+  else if (size > inode_length (inode) - offset)
+    size = inode_length (inode) - offset;
+  if (inode->data.flags & INODE_INLINE)
+    {
+      while (bytes_read < size)
+        {
+          int chunk_size = size - bytes_read;
+          buffer = iov_next (&pos, &left);
+          if ((size_t) chunk_size > left)
+            chunk_size = left;
+          memcpy (buffer, inode->data.inline_data + offset + bytes_read,
+                  chunk_size);
+          pos.ofs += chunk_size;
+          bytes_read += chunk_size;
+        }
+      rwlock_release_read (&inode->rw);
+      return bytes_read;
+    }
+  if (!direct)
+    inode_readahead (inode, size, offset);
 
   while (size > 0)
     {
@@ -268,18 +1057,30 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
       int min_left = inode_left < sector_left ? inode_left : sector_left;
 
-      /* Number of bytes to actually copy out of this sector. */
+      /* Number of bytes to actually copy out of this sector, no
+         more than fit in the current buffer. */
       int chunk_size = size < min_left ? size : min_left;
       if (chunk_size <= 0)
         break;
-      cached_read(sector_idx, sector_ofs, buffer + bytes_read,chunk_size);
+      buffer = iov_next (&pos, &left);
+      if ((size_t) chunk_size > left)
+        chunk_size = left;
+      if (sector_idx == 0)
+        memset (buffer, 0, chunk_size);
+      else if (direct && sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
+        direct_read (sector_idx, buffer);
+      else if (inode->metadata)
+        cached_read (sector_idx, sector_ofs, buffer, chunk_size);
+      else
+        cached_read_data (sector_idx, sector_ofs, buffer, chunk_size);
 
       /* Advance. */
       size -= chunk_size;
       offset += chunk_size;
       bytes_read += chunk_size;
+      pos.ofs += chunk_size;
     }
-  sema_up (&inode->sema);
+  rwlock_release_read (&inode->rw);
   return bytes_read;
 }
 
@@ -291,18 +1092,113 @@ off_t
 inode_write_at (struct inode *inode, const void *buffer_, off_t size,
                 off_t offset)
 {
-  if (size + offset > inode->data.length){
-    if (!inode_resize(&(inode->data), size+offset))
-      return false;
-  }
+  struct iovec iov = { (void *) buffer_, size > 0 ? size : 0 };
+  return inode_write (inode, &iov, 1, offset, false);
+}
+
+/* Like inode_write_at(), but whole aligned sectors go straight
+   from BUFFER to the disk.  A cached copy of such a sector is
+   updated rather than left stale, but no new cache block is
+   taken for it. */
+off_t
+inode_write_direct_at (struct inode *inode, const void *buffer_, off_t size,
+                       off_t offset)
+{
+  struct iovec iov = { (void *) buffer_, size > 0 ? size : 0 };
+  return inode_write (inode, &iov, 1, offset, true);
+}
+
+/* Writes the IOVCNT buffers in IOV, one after another, into
+   INODE, starting at OFFSET, and returns the number of bytes
+   actually written, which may be less than the buffers hold if
+   end of file is reached or an error occurs.  INODE is locked
+   once for the whole transfer, so the buffers land in the file
+   together.  If DIRECT is true, writes whole sectors like
+   inode_write_direct_at(). */
+off_t
+inode_writev_at (struct inode *inode, const struct iovec *iov, int iovcnt,
+                 off_t offset, bool direct)
+{
+  return inode_write (inode, iov, iovcnt, offset, direct);
+}
 
-  const uint8_t *buffer = buffer_;
+static off_t
+inode_write (struct inode *inode, const struct iovec *iov, int iovcnt,
+             off_t offset, bool direct)
+{
+  struct iov_pos pos = { iov, 0 };
+  off_t size = iov_length (iov, iovcnt);
+  uint8_t *buffer;
+  size_t left;
   off_t bytes_written = 0;
-  uint8_t *bounce = NULL;
-  if (inode->deny_write_cnt)
+  block_sector_t hint = inode->sector;
+  bool exclusive;
+  bool deferred = false;
+
+  /* Keep offset + size from passing the largest file, which also
+     keeps it from overflowing. */
+  if (offset >= INODE_MAX_LENGTH)
     return 0;
+  if (size > INODE_MAX_LENGTH - offset)
+    size = INODE_MAX_LENGTH - offset;
+  exclusive = (size + offset > inode_length (inode)
+               || (inode->data.flags & INODE_INLINE));
+
+  /* Writes inside the file share the lock with readers and with
+     each other; each sector is updated atomically under its
+     cache block's lock.  Only growing the file or filling a hole
+     changes the block map, and that needs INODE to itself, as
+     does writing inline data, which lives in INODE.  An inode
+     never goes back to inline, so seeing the flag clear without
+     the lock is safe.  The
+     length can change before the shared lock is taken, so it is
+     checked again afterward. */
+  journal_begin ();
+  if (!exclusive)
+    {
+      rwlock_acquire_read (&inode->rw);
+      if (size + offset > inode_length (inode))
+        {
+          rwlock_release_read (&inode->rw);
+          exclusive = true;
+        }
+    }
+  if (exclusive)
+    rwlock_acquire_write (&inode->rw);
+
+  if (inode->deny_write_cnt)
+    goto done;
+  if (exclusive && size + offset > inode->data.length)
+    {
+      bool was_inline = inode->data.flags & INODE_INLINE;
+      inode_map_invalidate (inode);
+      inode->map_dirty = true;
+      if (!inode_resize_near (&inode->data, size + offset, inode->sector))
+        goto done;
+      /* The inline data just moved out to a block of its own. */
+      if (was_inline && !(inode->data.flags & INODE_INLINE)
+          && inode->data.direct[0] != 0)
+        cache_claim (inode->data.direct[0], inode);
+    }
+
+  if (inode->data.flags & INODE_INLINE)
+    {
+      while (bytes_written < size)
+        {
+          int chunk_size = size - bytes_written;
+          buffer = iov_next (&pos, &left);
+          if ((size_t) chunk_size > left)
+            chunk_size = left;
+          memcpy (inode->data.inline_data + offset + bytes_written, buffer,
+                  chunk_size);
+          pos.ofs += chunk_size;
+          bytes_written += chunk_size;
+        }
+      if (size > 0)
+        cached_write_meta (inode->sector, 0, &inode->data, BLOCK_SECTOR_SIZE);
+      goto done;
+    }
 
-  sema_down (&inode->sema);
   while (size > 0)
     {
       /* Sector to write, starting byte offset within sector. */
@@ -313,41 +1209,64 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       off_t inode_left = inode_length (inode) - offset;
       int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
       int min_left = inode_left < sector_left ? inode_left : sector_left;
-      /* Number of bytes to actually write into this sector. */
+      /* Number of bytes to actually write into this sector, no
+         more than the current buffer holds. */
       int chunk_size = size < min_left ? size : min_left;
       if (chunk_size <= 0)
         break;
+      buffer = iov_next (&pos, &left);
+      if ((size_t) chunk_size > left)
+        chunk_size = left;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
+      if (sector_idx == 0)
         {
-          /* Write full sector directly to disk. */
-          cached_write(sector_idx, 0, buffer + bytes_written, BLOCK_SECTOR_SIZE);
-        }
-      else
-        {
-          /* We need a bounce buffer. */
-          if (bounce == NULL)
+          /* A hole.  Trade a shared lock for an exclusive one and
+             look again, since another writer may fill it first. */
+          if (!exclusive)
             {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
+              rwlock_release_read (&inode->rw);
+              rwlock_acquire_write (&inode->rw);
+              exclusive = true;
+              continue;
             }
-
-          if (sector_ofs > 0 || chunk_size < sector_left)
-            cached_read(sector_idx, 0, bounce,BLOCK_SECTOR_SIZE); 
-          else
-            memset (bounce, 0, BLOCK_SECTOR_SIZE);
-          memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-          cached_write(sector_idx, 0, bounce,BLOCK_SECTOR_SIZE);          
+          /* Sectors allocated for holes go out in one free map
+             write.  The free map stays locked until then, so this
+             waits until INODE's lock can no longer be given up. */
+          if (!deferred)
+            {
+              free_map_defer ();
+              deferred = true;
+            }
+          sector_idx = tree_allocate (inode, offset, hint,
+                                      chunk_size < BLOCK_SECTOR_SIZE);
+          if (sector_idx == 0)
+            break;
+          inode->map_dirty = true;
         }
+      hint = sector_idx;
+
+      if (direct && sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
+        direct_write (sector_idx, buffer);
+      else if (inode->metadata)
+        cached_write_meta (sector_idx, sector_ofs, buffer, chunk_size);
+      else
+        cached_write_data (inode, sector_idx, sector_ofs, buffer, chunk_size);
 
       /* Advance. */
       size -= chunk_size;
       offset += chunk_size;
       bytes_written += chunk_size;
+      pos.ofs += chunk_size;
     }
-  free (bounce);
-  sema_up (&inode->sema);
+  if (deferred)
+    free_map_commit ();
+
+ done:
+  if (exclusive)
+    rwlock_release_write (&inode->rw);
+  else
+    rwlock_release_read (&inode->rw);
+  journal_end ();
   return bytes_written;
 }
 
@@ -378,167 +1297,820 @@ inode_length (const struct inode *inode)
   return inode->data.length;
 }
 
+/* Marks INODE as holding file system metadata, such as a
+   directory or the free map, so that writes to it go through the
+   journal. */
+void
+inode_set_metadata (struct inode *inode)
+{
+  inode->metadata = true;
+}
+
+/* Writes INODE's dirty data blocks to disk, then INODE itself
+   and the rest of the metadata through the journal, and returns
+   once they are all there.  If DATA_ONLY is true, the metadata
+   is skipped when INODE's length and block map have not changed
+   since it was last synced, since the data can be read back
+   without it.  Must not be called inside a journaled operation. */
+void
+inode_sync (struct inode *inode, bool data_only)
+{
+  unsigned overflows;
+
+  cache_sync_inode (inode);
+  if (data_only && !inode->map_dirty)
+    return;
+  inode->map_dirty = false;
+
+  journal_begin ();
+  rwlock_acquire_read (&inode->rw);
+  cached_write_meta (inode->sector, 0, &inode->data, BLOCK_SECTOR_SIZE);
+  rwlock_release_read (&inode->rw);
+  journal_end ();
+
+  /* Metadata written while the journal was full is not pinned
+     for the next commit, so only a full write-back is sure to
+     catch it. */
+  overflows = journal_overflow_cnt ();
+  if (overflows != synced_overflows)
+    {
+      synced_overflows = overflows;
+      cache_flush ();
+    }
+  else
+    journal_commit ();
+}
+
+/* Returns true if INODE's unwritten blocks take no disk space,
+   which is so unless it uses extents. */
+bool
+inode_is_sparse (const struct inode *inode)
+{
+  return (inode->data.flags & INODE_EXTENTS) == 0;
+}
+
 
 // helper functions
-void  cached_read(block_sector_t sector, int sector_ofs, const void* buffer, int size){
+// read metadata, such as an inode or a pointer block
+void  cached_read(block_sector_t sector, int sector_ofs, void* buffer, int size){
   int cache_idx = sector_num_to_cache_idx(sector);
+  cache_set_meta (cache_idx, true);
   memcpy (buffer,Cache[cache_idx].data + sector_ofs, size);
   release_lock_for_cache_block(cache_idx);
   return;
 }
 
+// read file data
+void cached_read_data(block_sector_t sector, int sector_ofs, void* buffer, int size){
+  int cache_idx = sector_num_to_cache_idx(sector);
+  cache_set_meta (cache_idx, false);
+  memcpy (buffer,Cache[cache_idx].data + sector_ofs, size);
+  release_lock_for_cache_block(cache_idx);
+}
+
 void cached_write(block_sector_t sector, int sector_ofs, const void* buffer, int size){
   int cache_idx = sector_num_to_cache_idx(sector);
   Cache[cache_idx].dirty = 1;
+  Cache[cache_idx].flushed = 0;
   memcpy (Cache[cache_idx].data + sector_ofs,buffer, size);
   release_lock_for_cache_block(cache_idx);
 }
 
-//try find block in the cache, return cache idx if find one, -1 o.w.
-int block_in_cache(const block_sector_t sector){
-  int i;
-  for (i=0;i<CACHE_SIZE;i++)
-  {
-    if (Cache[i].valid ==1 && Cache[i].sector==sector)
+// cached_write() for a data block of INODE, which then counts
+// the block among its dirty blocks for inode_sync()
+void cached_write_data(struct inode *inode, block_sector_t sector, int sector_ofs, const void* buffer, int size){
+  int cache_idx = sector_num_to_cache_idx(sector);
+  Cache[cache_idx].dirty = 1;
+  Cache[cache_idx].flushed = 0;
+  cache_set_owner (cache_idx, inode);
+  memcpy (Cache[cache_idx].data + sector_ofs,buffer, size);
+  release_lock_for_cache_block(cache_idx);
+}
+
+// cached_write() for metadata.  within a journaled operation
+// SECTOR joins the running transaction and its block is pinned
+// in the cache until the transaction commits.
+void cached_write_meta(block_sector_t sector, int sector_ofs, const void* buffer, int size){
+  bool journaled = journal_add (sector);
+  int cache_idx = sector_num_to_cache_idx(sector);
+  cache_set_meta (cache_idx, true);
+  Cache[cache_idx].dirty = 1;
+  Cache[cache_idx].flushed = 0;
+  if (journaled)
+    Cache[cache_idx].journaled = 1;
+  memcpy (Cache[cache_idx].data + sector_ofs,buffer, size);
+  release_lock_for_cache_block(cache_idx);
+}
+
+// write the cached copy of pinned SECTOR to LOG_SECTOR for a
+// commit.  returns false if SECTOR is not cached.
+bool cache_log_block(block_sector_t sector, block_sector_t log_sector){
+  int cache_idx = cache_lookup_locked (sector);
+  if (cache_idx==-1)
+    return false;
+  block_write (fs_device, log_sector, Cache[cache_idx].data);
+  lock_release (&Cache[cache_idx].cache_block_lock);
+  return true;
+}
+
+// unpin SECTOR after a commit, first writing it back to its home
+// if HOME is true.
+void cache_unpin_block(block_sector_t sector, bool home){
+  int cache_idx = cache_lookup_locked (sector);
+  if (cache_idx==-1)
+    return;
+  if (home && Cache[cache_idx].dirty==1){
+    block_write (fs_device, sector, Cache[cache_idx].data);
+    Cache[cache_idx].dirty = 0;
+    Cache[cache_idx].flushed = 1;
+    cache_set_owner (cache_idx, NULL);
+  }
+  Cache[cache_idx].journaled = 0;
+  lock_release (&Cache[cache_idx].cache_block_lock);
+}
+
+// orders cache_ios by sector
+static int compare_cache_io (const void *a_, const void *b_){
+  const struct cache_io *a = a_;
+  const struct cache_io *b = b_;
+  return a->sector < b->sector ? -1 : a->sector > b->sector;
+}
+
+// carry out the CNT copies in IOS in one pass over the cache, in
+// order of sector so that any misses read the disk in one sweep.
+// each sector is looked up and locked once however many pieces
+// of it IOS names.  IOS is sorted in place, so two writes must
+// not overlap.
+static void cache_many (struct cache_io *ios, size_t cnt, bool write){
+  size_t i = 0;
+  qsort (ios, cnt, sizeof *ios, compare_cache_io);
+  while (i < cnt){
+    block_sector_t sector = ios[i].sector;
+    int cache_idx = sector_num_to_cache_idx (sector);
+    for (; i < cnt && ios[i].sector == sector; i++){
+      uint8_t *data = Cache[cache_idx].data + ios[i].ofs;
+      if (write)
+        memcpy (data, ios[i].buffer, ios[i].size);
+      else
+        memcpy (ios[i].buffer, data, ios[i].size);
+    }
+    if (write){
+      Cache[cache_idx].dirty = 1;
+      Cache[cache_idx].flushed = 0;
+    } else {
+      // batched reads are all of pointer blocks
+      cache_set_meta (cache_idx, true);
+    }
+    release_lock_for_cache_block (cache_idx);
+  }
+}
+
+// batched cached_read(): reorders IOS, see cache_many()
+void cached_read_many(struct cache_io *ios, size_t cnt){
+  cache_many (ios, cnt, false);
+}
+
+// batched cached_write(): reorders IOS, see cache_many()
+void cached_write_many(struct cache_io *ios, size_t cnt){
+  cache_many (ios, cnt, true);
+}
+
+// returns the slot holding SECTOR with its lock held, or -1 if
+// SECTOR is not cached.  never loads anything.
+static int cache_lookup_locked (block_sector_t sector){
+  int cache_idx;
+  while (true){
+    lock_acquire (&cache_lock);
+    cache_idx = block_in_cache (sector);
+    lock_release (&cache_lock);
+    if (cache_idx==-1)
+      return -1;
+    acquire_lock_for_cache_block (cache_idx);
+    if (Cache[cache_idx].valid==1 && Cache[cache_idx].sector==sector)
+      return cache_idx;
+    lock_release (&Cache[cache_idx].cache_block_lock);
+  }
+}
+
+// read a whole sector into BUFFER without taking a cache block.
+// a cached copy may be newer than the disk, so it wins.
+void direct_read(block_sector_t sector, void* buffer){
+  int cache_idx = cache_lookup_locked (sector);
+  if (cache_idx!=-1){
+    memcpy (buffer, Cache[cache_idx].data, BLOCK_SECTOR_SIZE);
+    lock_release (&Cache[cache_idx].cache_block_lock);
+    return;
+  }
+  block_read (fs_device, sector, buffer);
+  direct_reads++;
+}
+
+// write a whole sector from BUFFER to disk without taking a
+// cache block.  a cached copy is refreshed so it cannot be
+// written back over the new data later.
+void direct_write(block_sector_t sector, const void* buffer){
+  int cache_idx = cache_lookup_locked (sector);
+  if (cache_idx!=-1){
+    memcpy (Cache[cache_idx].data, buffer, BLOCK_SECTOR_SIZE);
+    block_write (fs_device, sector, buffer);
+    Cache[cache_idx].dirty = 0;
+    cache_set_owner (cache_idx, NULL);
+    lock_release (&Cache[cache_idx].cache_block_lock);
+    direct_writes++;
+    return;
+  }
+  block_write (fs_device, sector, buffer);
+  direct_writes++;
+  // read-ahead may have loaded the old contents meanwhile
+  cache_idx = cache_lookup_locked (sector);
+  if (cache_idx!=-1){
+    if (Cache[cache_idx].dirty==0)
+      memcpy (Cache[cache_idx].data, buffer, BLOCK_SECTOR_SIZE);
+    lock_release (&Cache[cache_idx].cache_block_lock);
+  }
+}
+
+//try find block in the cache, return cache idx if find one, -1 o.w.
+// caller must hold cache_lock.
+int block_in_cache(const block_sector_t sector){
+  struct cached_block key;
+  struct hash_elem *e;
+
+  ASSERT (lock_held_by_current_thread (&cache_lock));
+  index_lookups++;
+  key.sector = sector;
+  e = hash_find (&cache_index, &key.hash_elem);
+  if (e == NULL)
+    return -1;
+  return hash_entry (e, struct cached_block, hash_elem) - Cache;
+}
+
+static unsigned
+cache_index_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct cached_block *b = hash_entry (e, struct cached_block, hash_elem);
+  return hash_int (b->sector);
+}
+
+static bool
+cache_index_less (const struct hash_elem *a_, const struct hash_elem *b_,
+                  void *aux UNUSED)
+{
+  const struct cached_block *a = hash_entry (a_, struct cached_block, hash_elem);
+  const struct cached_block *b = hash_entry (b_, struct cached_block, hash_elem);
+  index_compares++;
+  return a->sector < b->sector;
+}
+
+// add a freshly filled slot to the sector index, cache_lock held
+static void cache_index_insert (int cache_idx){
+  hash_insert (&cache_index, &Cache[cache_idx].hash_elem);
+}
+
+// drop a slot from the sector index before it is reused, cache_lock held
+static void cache_index_remove (int cache_idx){
+  hash_delete (&cache_index, &Cache[cache_idx].hash_elem);
+}
+
+// lock slot I for eviction if it is idle and not pinned for the
+// journal.  cache_lock held.
+static bool cache_try_evict (int i){
+  if (Cache[i].journaled!=0 || !lock_try_acquire (&Cache[i].cache_block_lock))
+    return false;
+  if (Cache[i].journaled==0)
+    return true;
+  lock_release (&Cache[i].cache_block_lock);
+  return false;
+}
+
+// sweep the clock hand for a slot to evict, looking only at slots
+// in QUEUE unless it is -1.  cache_lock held.
+static int cache_sweep (int queue){
+  int i, steps;
+  for (steps = 0; steps < 2 * CACHE_SIZE; steps++){
+    i = hand;
+    hand = (hand+1)%CACHE_SIZE;
+    if (queue != -1 && Cache[i].queue != queue)
+      continue;
+    if (Cache[i].clock!=0)
+      Cache[i].clock -= 1;
+    else if (cache_try_evict (i))
       return i;
   }
   return -1;
 }
 
+// the 2Q choice of victim: the oldest A1 slot if A1 is over its
+// share, else a slot in Am by clock.  -1 if neither has one free.
+// cache_lock held.
+static int cache_pick_2q (void){
+  struct list_elem *e;
+  if (list_size (&a1_list) > cache_size / 4){
+    for (e = list_begin (&a1_list); e != list_end (&a1_list); e = list_next (e)){
+      int i = list_entry (e, struct cached_block, a1_elem) - Cache;
+      if (cache_try_evict (i))
+        return i;
+    }
+  }
+  return cache_sweep (CACHE_AM);
+}
+
+// is SECTOR in the 2Q ghost ring?  cache_lock held.
+static bool ghost_contains (block_sector_t sector){
+  size_t i;
+  for (i = 0; i < ghost_cnt; i++)
+    if (ghost[i] == sector)
+      return true;
+  return false;
+}
 
-int evict_and_overwrite(block_sector_t sector){
+// remember SECTOR, just evicted from A1.  cache_lock held.
+static void ghost_add (block_sector_t sector){
+  ghost[ghost_next] = sector;
+  ghost_next = (ghost_next + 1) % ghost_size;
+  if (ghost_cnt < ghost_size)
+    ghost_cnt++;
+}
+
+// note that slot CACHE_IDX, whose lock the caller holds, was just
+// used as metadata if META is true or as file data if not.  under
+// 2Q, metadata moves from A1 to Am, and it takes longer to age.
+static void cache_set_meta (int cache_idx, bool meta){
+  Cache[cache_idx].meta = meta;
+  if (cache_policy == CACHE_2Q && meta && Cache[cache_idx].queue == CACHE_A1){
+    lock_acquire (&cache_lock);
+    list_remove (&Cache[cache_idx].a1_elem);
+    Cache[cache_idx].queue = CACHE_AM;
+    lock_release (&cache_lock);
+  }
+}
+
+// pick a slot to reuse and return it with its block lock held.
+// called with cache_lock held.  slots that are busy are skipped
+// rather than waited for, so a miss never stalls behind hits on
+// other sectors.  if every slot stays busy for a couple of sweeps,
+// cache_lock is dropped and -1 is returned so the caller retries.
+static int cache_pick_victim (void){
   int i;
+
   //find a free block
   for (i=0;i<CACHE_SIZE;i++)
   {
-    if (Cache[i].valid ==0){
-      Cache[i].valid = 1;
-      Cache[i].clock = 0;
-      Cache[i].dirty = 0;
-      Cache[i].sector= sector;
-      memset (Cache[i].data, 0, BLOCK_SECTOR_SIZE);
-      block_read (fs_device, Cache[i].sector, Cache[i].data);
+    if (Cache[i].valid==0 && lock_try_acquire (&Cache[i].cache_block_lock))
       return i;
-    } 
-  } 
+  }
 
-  // if there is no free block, evict a block by clock algorithm
-  while (true){
-    if (Cache[hand].clock!=0){
-      Cache[hand].clock -= 1;
-      hand = (hand+1)%CACHE_SIZE;
-    }
-    else{
-      evict_cache(hand);
-      int i=hand;
-      hand = (hand+1)%CACHE_SIZE;
-      Cache[i].valid = 1;
-      Cache[i].clock = 0;
-      Cache[i].dirty = 0;
-      Cache[i].sector= sector;
-      memset (Cache[i].data, 0, BLOCK_SECTOR_SIZE);
-      block_read (fs_device, Cache[i].sector, Cache[i].data);
-      return i;
+  // if there is no free block, evict a block by the policy in
+  // force.  blocks pinned for the journal are passed over.
+  if (cache_policy == CACHE_2Q && (i = cache_pick_2q ()) != -1)
+    return i;
+  if ((i = cache_sweep (-1)) != -1)
+    return i;
+  lock_release (&cache_lock);
+  thread_yield ();
+  return -1;
+}
+
+// load SECTOR into a victim slot.  called with cache_lock held,
+// returns with cache_lock released and the slot lock held, or -1
+// with no locks held if the caller has to look SECTOR up again.
+int evict_and_overwrite(block_sector_t sector){
+  int i = cache_pick_victim ();
+  if (i == -1)
+    return -1;
+
+  if (Cache[i].valid==1 && Cache[i].dirty==1){
+    // write the old contents back without cache_lock, along with
+    // any dirty blocks for the sectors right after it that are
+    // free to lock, so they cost nothing when their turn comes.
+    // the old sector stays indexed meanwhile, so anyone after it
+    // waits on the slot lock instead of reading a stale copy.
+    int run[CACHE_RUN_MAX];
+    size_t n = 0, k;
+    run[n++] = i;
+    while (n < CACHE_RUN_MAX){
+      int j = block_in_cache (Cache[i].sector + n);
+      if (j==-1 || !lock_try_acquire (&Cache[j].cache_block_lock))
+        break;
+      if (Cache[j].dirty==0 || Cache[j].journaled==1){
+        lock_release (&Cache[j].cache_block_lock);
+        break;
+      }
+      run[n++] = j;
     }
+    lock_release (&cache_lock);
+    cache_write_run (run, n);
+    for (k = 1; k < n; k++)
+      lock_release (&Cache[run[k]].cache_block_lock);
+    lock_acquire (&cache_lock);
+    if (block_in_cache (sector) != -1){
+      // someone else brought SECTOR in while we were writing
+      lock_release (&cache_lock);
+      lock_release (&Cache[i].cache_block_lock);
+      return -1;
+    }
+  } else if (Cache[i].valid==1 && Cache[i].flushed==1) {
+    // the flusher already paid for this write-back
+    stalls_avoided++;
   }
-}
 
-void evict_cache(int i){
-  if (Cache[i].valid==0)
-    return;
-  if (Cache[i].dirty==1){
-    block_write (fs_device, Cache[i].sector, Cache[i].data);
+  if (Cache[i].valid==1){
+    cache_index_remove (i);
+    if (Cache[i].queue == CACHE_A1){
+      list_remove (&Cache[i].a1_elem);
+      ghost_add (Cache[i].sector);
+    }
   }
-  Cache[i].valid=0;
-  return;
+  Cache[i].valid = 1;
+  Cache[i].clock = 0;
+  Cache[i].dirty = 0;
+  Cache[i].flushed = 0;
+  Cache[i].meta = 0;
+  Cache[i].queue = CACHE_AM;
+  if (cache_policy == CACHE_2Q && !ghost_contains (sector)){
+    Cache[i].queue = CACHE_A1;
+    list_push_back (&a1_list, &Cache[i].a1_elem);
+  }
+  Cache[i].sector= sector;
+  cache_index_insert (i);
+  lock_release (&cache_lock);
+
+  // only this slot is locked during the read; readers of SECTOR
+  // find it in the index and wait for the slot lock.
+  block_read (fs_device, sector, Cache[i].data);
+  return i;
 }
 
 //this function returns the cache entry of the sector, if the sector is not in cache, load it into the cache
-// bring block sector into cache, acquire the reading lock of that cache.
+// bring block sector into cache, acquire the lock of that cache block.
 int sector_num_to_cache_idx(const block_sector_t pointer){
-  int cache_idx = block_in_cache(pointer);
-  if (cache_idx==-1){
-    //block is not in cache
-    misses++;
-    acquire_lock_for_evicting();
+  int cache_idx;
+  while (true){
+    lock_acquire (&cache_lock);
     cache_idx = block_in_cache(pointer);
-    if (cache_idx!=-1){
-      //block now in the cache
-      release_lock_for_evicting();
-    } else {
+    if (cache_idx==-1){
+      //block is not in cache
+      misses++;
       cache_idx = evict_and_overwrite(pointer);
-      release_lock_for_evicting();
+      if (cache_idx!=-1)
+        return cache_idx;
+    } else {
+      hits++;
+      lock_release (&cache_lock);
+      acquire_lock_for_cache_block(cache_idx);
+      //the slot may have been recycled while we waited for it
+      if (Cache[cache_idx].valid==1 && Cache[cache_idx].sector==pointer)
+        return cache_idx;
+      lock_release (&Cache[cache_idx].cache_block_lock);
     }
-  } else {
-    hits++;
   }
-  acquire_lock_for_cache_block(cache_idx);
-  return cache_idx;
 }
 
 
 
 
+static int
+flush_entry_cmp (const void *a_, const void *b_)
+{
+  const struct flush_entry *a = a_;
+  const struct flush_entry *b = b_;
+  return a->sector < b->sector ? -1 : a->sector > b->sector;
+}
+
+// write the N slots in RUN, which hold consecutive sectors in
+// order and are locked and dirty, back as one device request and
+// mark them clean.
+static void cache_write_run (const int *run, size_t n){
+  const void *buffers[CACHE_RUN_MAX];
+  size_t k;
+  ASSERT (n > 0 && n <= CACHE_RUN_MAX);
+  for (k = 0; k < n; k++)
+    buffers[k] = Cache[run[k]].data;
+  block_write_multiple (fs_device, Cache[run[0]].sector, buffers, n);
+  for (k = 0; k < n; k++){
+    Cache[run[k]].dirty = 0;
+    Cache[run[k]].flushed = 1;
+    cache_set_owner (run[k], NULL);
+  }
+}
+
+// make slot CACHE_IDX, whose lock the caller holds, one of
+// INODE's dirty blocks, or nobody's if INODE is null
+static void cache_set_owner (int cache_idx, struct inode *inode){
+  struct cached_block *b = &Cache[cache_idx];
+  lock_acquire (&dirty_lock);
+  if (b->owner != inode){
+    if (b->owner != NULL)
+      list_remove (&b->dirty_elem);
+    b->owner = inode;
+    if (inode != NULL)
+      list_push_back (&inode->dirty_blocks, &b->dirty_elem);
+  }
+  lock_release (&dirty_lock);
+}
+
+// make SECTOR one of INODE's dirty blocks if it is cached and dirty
+static void cache_claim (block_sector_t sector, struct inode *inode){
+  int cache_idx = cache_lookup_locked (sector);
+  if (cache_idx==-1)
+    return;
+  if (Cache[cache_idx].dirty==1)
+    cache_set_owner (cache_idx, inode);
+  lock_release (&Cache[cache_idx].cache_block_lock);
+}
+
+// forget INODE's dirty blocks before INODE is freed
+static void cache_disown (struct inode *inode){
+  lock_acquire (&dirty_lock);
+  while (!list_empty (&inode->dirty_blocks)){
+    struct list_elem *e = list_pop_front (&inode->dirty_blocks);
+    list_entry (e, struct cached_block, dirty_elem)->owner = NULL;
+  }
+  lock_release (&dirty_lock);
+}
+
+// write INODE's dirty data blocks back, in sector order and in
+// runs like cache_write_back(), without looking at the rest of
+// the cache
+static void cache_sync_inode (struct inode *inode){
+  struct list_elem *e;
+  int cnt = 0;
+
+  lock_acquire (&flush_lock);
+  lock_acquire (&dirty_lock);
+  for (e = list_begin (&inode->dirty_blocks); e != list_end (&inode->dirty_blocks);
+       e = list_next (e)){
+    struct cached_block *b = list_entry (e, struct cached_block, dirty_elem);
+    flush_order[cnt].sector = b->sector;
+    flush_order[cnt].cache_idx = b - Cache;
+    cnt++;
+  }
+  lock_release (&dirty_lock);
+  sync_writes += cache_write_entries (cnt);
+  lock_release (&flush_lock);
+}
+
+// is the slot FE names still dirty with the same sector, and not
+// pinned?  the slot lock must be held.  it may have been written
+// back, reused or pinned since FE was taken.
+static bool flush_entry_current (const struct flush_entry *fe){
+  const struct cached_block *b = &Cache[fe->cache_idx];
+  return b->valid==1 && b->dirty==1 && b->journaled==0 && b->sector==fe->sector;
+}
+
+// commit the journal, then write every other dirty block back to
+// disk, leaving the blocks cached.  see cache_write_back().
+void cache_flush (void){
+  journal_commit ();
+  lock_acquire (&flush_lock);
+  cache_write_back ();
+  lock_release (&flush_lock);
+}
+
+// write every dirty block not pinned for the journal back.
+// blocks pinned by operations that started since the last commit
+// wait for the next one.  flush_lock must be held.
+static void cache_write_back (void){
+  int i, cnt = 0;
+
+  lock_acquire (&cache_lock);
+  for (i=0;i<CACHE_SIZE;i++){
+    if (Cache[i].valid==1 && Cache[i].dirty==1 && Cache[i].journaled==0){
+      flush_order[cnt].sector = Cache[i].sector;
+      flush_order[cnt].cache_idx = i;
+      cnt++;
+    }
+  }
+  lock_release (&cache_lock);
+  flushes += cache_write_entries (cnt);
+}
+
+// write back the blocks of the first CNT entries of flush_order
+// that are still dirty and not pinned, in sector order, each run
+// of consecutive sectors as one request.  only the first block
+// of a run is waited for; the rest are taken only if they are
+// free, so this never sleeps holding more than one slot lock and
+// readers of other sectors are not held up.  returns the number
+// of blocks written.  flush_lock must be held.
+static unsigned cache_write_entries (int cnt){
+  unsigned written = 0;
+  int i = 0;
+
+  qsort (flush_order, cnt, sizeof *flush_order, flush_entry_cmp);
+  while (i < cnt){
+    int run[CACHE_RUN_MAX];
+    size_t n = 0, k;
+    int idx = flush_order[i].cache_idx;
+
+    lock_acquire (&Cache[idx].cache_block_lock);
+    if (flush_entry_current (&flush_order[i]))
+      run[n++] = idx;
+    else
+      lock_release (&Cache[idx].cache_block_lock);
+    for (i++; n > 0 && n < CACHE_RUN_MAX && i < cnt
+           && flush_order[i].sector == flush_order[i-1].sector + 1; i++){
+      idx = flush_order[i].cache_idx;
+      if (!lock_try_acquire (&Cache[idx].cache_block_lock))
+        break;
+      if (!flush_entry_current (&flush_order[i])){
+        lock_release (&Cache[idx].cache_block_lock);
+        break;
+      }
+      run[n++] = idx;
+    }
+    if (n == 0)
+      continue;
+    cache_write_run (run, n);
+    written += n;
+    for (k = 0; k < n; k++)
+      lock_release (&Cache[run[k]].cache_block_lock);
+  }
+  return written;
+}
+
+// body of the write-behind thread started by filesys_init()
+void cache_flusher (void *aux UNUSED){
+  for (;;){
+    sema_down (&flush_due);
+    cache_flush ();
+  }
+}
+
+// called by the timer interrupt handler at tick NOW: wakes the
+// flusher once every FLUSH_INTERVAL.  a wakeup that comes while a
+// pass is still running is not saved up for later.
+void cache_tick (int64_t now){
+  if (flush_due_ready && now % FLUSH_INTERVAL == 0 && flush_due.value == 0)
+    sema_up (&flush_due);
+}
+
+// bring SECTOR into the cache for a reader that has not asked
+// for it yet.  not counted as a hit or a miss, so hit rates still
+// describe what readers saw.
+static void cache_prefetch (block_sector_t sector){
+  int cache_idx;
+  do {
+    lock_acquire (&cache_lock);
+    if (block_in_cache (sector) != -1){
+      lock_release (&cache_lock);
+      return;
+    }
+    cache_idx = evict_and_overwrite (sector);
+  } while (cache_idx == -1);
+  readaheads++;
+  release_lock_for_cache_block (cache_idx);
+}
+
+// body of the read-ahead thread started by filesys_init()
+void cache_readahead (void *aux UNUSED){
+  block_sector_t sector;
+  for (;;){
+    lock_acquire (&ra_queue_lock);
+    while (ra_cnt == 0)
+      cond_wait (&ra_queue_nonempty, &ra_queue_lock);
+    sector = ra_queue[ra_head];
+    ra_head = (ra_head + 1) % RA_QUEUE_SIZE;
+    ra_cnt--;
+    lock_release (&ra_queue_lock);
+
+    lock_acquire (&ra_lock);
+    cache_prefetch (sector);
+    lock_release (&ra_lock);
+  }
+}
+
 void acquire_lock_for_cache_block(int cache_idx ){
   lock_acquire (&(Cache[cache_idx].cache_block_lock));
   return;
 }
 void release_lock_for_cache_block(int cache_idx){
-  Cache[cache_idx].clock=1;
+  if (cache_policy == CACHE_2Q && Cache[cache_idx].meta)
+    Cache[cache_idx].clock = CACHE_META_CHANCES;
+  else
+    Cache[cache_idx].clock = 1;
   lock_release (&(Cache[cache_idx].cache_block_lock));
   return;
 }
 
-void acquire_lock_for_evicting(){
-  int i;
-  for (i=0;i<CACHE_SIZE;i++){
-    acquire_lock_for_cache_block(i);
-  }
-  return;
+/* Returns the number of pointer blocks a tree-format inode
+   SECTORS long needs. */
+static size_t
+tree_meta_sectors (size_t sectors)
+{
+  size_t meta = 0;
+  if (sectors > 112)
+    meta++;
+  if (sectors > 112 + 128)
+    meta += 1 + DIV_ROUND_UP (sectors - 112 - 128, 128);
+  return meta;
 }
 
-void release_lock_for_evicting(){
-  int i;
-  for (i=0;i<CACHE_SIZE;i++){
-    release_lock_for_cache_block(i);
-  }
-  return;
+/* Takes from the free map, in one go, the sectors that growing a
+   tree-format inode from OLD_SECTORS to NEW_SECTORS should need:
+   the data sectors as one set of runs, then the pointer blocks
+   as another, so that pointer blocks do not split up the data.
+   Both are placed as soon after HINT as there is room.
+   Returns false if the disk cannot hold them.  POOL must be
+   passed to pool_done() either way. */
+static bool
+pool_init (struct sector_pool *pool, size_t old_sectors, size_t new_sectors,
+           block_sector_t hint)
+{
+  size_t old_meta = tree_meta_sectors (old_sectors);
+  size_t new_meta = tree_meta_sectors (new_sectors);
+
+  pool->sectors = NULL;
+  pool->data_cnt = pool->data_next = 0;
+  pool->meta_cnt = pool->meta_next = 0;
+  if (new_sectors <= old_sectors)
+    return true;
+
+  pool->sectors = malloc ((new_sectors - old_sectors + new_meta - old_meta)
+                          * sizeof *pool->sectors);
+  if (pool->sectors == NULL)
+    return false;
+  if (!free_map_allocate_multiple (new_sectors - old_sectors, hint,
+                                   pool->sectors))
+    return false;
+  pool->data_cnt = new_sectors - old_sectors;
+  if (!free_map_allocate_multiple (new_meta - old_meta, hint,
+                                   pool->sectors + pool->data_cnt))
+    return false;
+  pool->meta_cnt = new_meta - old_meta;
+  return true;
+}
+
+/* Hands out the next data sector from POOL, or falls back to
+   free_map_allocate() if POOL has run dry. */
+static bool
+pool_take_data (struct sector_pool *pool, block_sector_t *sectorp)
+{
+  if (pool->data_next < pool->data_cnt)
+    {
+      *sectorp = pool->sectors[pool->data_next++];
+      return true;
+    }
+  return free_map_allocate (1, sectorp);
+}
+
+/* Same as pool_take_data(), for pointer blocks. */
+static bool
+pool_take_meta (struct sector_pool *pool, block_sector_t *sectorp)
+{
+  if (pool->meta_next < pool->meta_cnt)
+    {
+      *sectorp = pool->sectors[pool->data_cnt + pool->meta_next++];
+      return true;
+    }
+  return free_map_allocate (1, sectorp);
+}
+
+/* Gives the sectors POOL did not hand out back to the free map
+   and frees POOL's memory. */
+static void
+pool_done (struct sector_pool *pool)
+{
+  for (; pool->data_next < pool->data_cnt; pool->data_next++)
+    free_map_release (pool->sectors[pool->data_next], 1);
+  for (; pool->meta_next < pool->meta_cnt; pool->meta_next++)
+    free_map_release (pool->sectors[pool->data_cnt + pool->meta_next], 1);
+  free (pool->sectors);
 }
 
 // task 2 helper functions:
 // given an array of direct pointers, allocate a block for each
-bool create_data_block(int num,struct inode_disk *disk_inode){
+static bool create_data_block_pool(int num,struct inode_disk *disk_inode,struct sector_pool *pool){
   int i;
-  for (i=0;i<=min(112,num);i++) {
-    if (!free_map_allocate (1, &(disk_inode->direct[i]))){
+  for (i=0;i<min(112,num);i++) {
+    if (!pool_take_data (pool, &(disk_inode->direct[i]))){
       return false;
     }
   }
 
   if (num>112) {
-    if (!free_map_allocate (1, &disk_inode->indirect)){
+    if (!pool_take_meta (pool, &disk_inode->indirect)){
       return false;
     }
     block_sector_t* indirect_buffer = malloc(BLOCK_SECTOR_SIZE);
-    if (false == create_data_block_indirect(min(num-112,128),disk_inode->indirect,indirect_buffer)){
+    if (false == create_data_block_indirect(min(num-112,128),disk_inode->indirect,indirect_buffer,pool)){
       return false;
     }
     
       if (num>112+128){
-        if (!free_map_allocate (1, &disk_inode->doubly_indirect)){
+        if (!pool_take_meta (pool, &disk_inode->doubly_indirect)){
           return false;
         }
         block_sector_t* double_buffer = malloc(BLOCK_SECTOR_SIZE);
         memset (double_buffer, 0, BLOCK_SECTOR_SIZE);
         for (i=0;i<num-112-128;i+=128){
-          if (!free_map_allocate (1, &(double_buffer[i/128]))){
+          if (!pool_take_meta (pool, &(double_buffer[i/128]))){
             return false;
           }
-          if (false == create_data_block_indirect(min(num-112-128-i,128),double_buffer[i/128],indirect_buffer)){
+          if (false == create_data_block_indirect(min(num-112-128-i,128),double_buffer[i/128],indirect_buffer,pool)){
             return false;
           }  
         }
-        cached_write(disk_inode->doubly_indirect,0,double_buffer,BLOCK_SECTOR_SIZE);
+        cached_write_meta(disk_inode->doubly_indirect,0,double_buffer,BLOCK_SECTOR_SIZE);
         free(double_buffer);
       }
     free(indirect_buffer);
@@ -547,78 +2119,59 @@ bool create_data_block(int num,struct inode_disk *disk_inode){
   return true;
 }
 
-
-bool inode_resize(struct inode_disk *id, off_t size){
-  int i;
-  for (i = 0; i < 112; i++) {
-    if (size <= BLOCK_SECTOR_SIZE * i && id->direct[i] != 0) {
-      free_map_release (id->direct[i],1);
-      id->direct[i] = 0;
-    }
-    if (size > BLOCK_SECTOR_SIZE * i && id->direct[i] == 0) {
-      if (!free_map_allocate (1, &id->direct[i])){
-        id->direct[i] = 0;
-        inode_resize(id, id->length);
-        return false;        
-      }
-      if (id->direct[i] == 0) {
-        inode_resize(id, id->length);
-        return false;
-      }
-    }
-  }
-  
-  if (id->indirect == 0 && size <= 112 * BLOCK_SECTOR_SIZE) {
-    id->length = size;
-    return true;
-  }
-
-  block_sector_t* indirect_buffer = malloc(BLOCK_SECTOR_SIZE);
-  if(!inode_resize_indirect(id,size,112,&id->indirect,indirect_buffer)){
+// allocate the data and pointer blocks of a new NUM sector file,
+// close after its inode sector HINT
+bool create_data_block(int num,struct inode_disk *disk_inode,block_sector_t hint){
+  struct sector_pool pool;
+  bool success;
+  // files that big are created sparse, see create_inode()
+  if (num > INODE_TRIPLY_START)
     return false;
-  }
-
+  free_map_defer ();
+  success = pool_init (&pool, 0, num, hint)
+            && create_data_block_pool (num, disk_inode, &pool);
+  pool_done (&pool);
+  free_map_commit ();
+  return success;
+}
 
-  //double
-  if (id->doubly_indirect == 0 && size <= (112 + 128) * BLOCK_SECTOR_SIZE) {
-    id->length = size;
-    return true;
-  }
 
-  int num_resized_block = 112 + 128;
-  block_sector_t* double_buffer = malloc(BLOCK_SECTOR_SIZE);
-  if (id->doubly_indirect == 0){
-    if (!free_map_allocate (1, &id->doubly_indirect)){
-      id->doubly_indirect = 0;
-      free(double_buffer);
-      free(indirect_buffer);
-      inode_resize(id, id->length);
-      return false;        
-    }
-    memset(double_buffer,0,BLOCK_SECTOR_SIZE);    
-  }else{
-    cached_read(id->doubly_indirect,0,double_buffer,BLOCK_SECTOR_SIZE);
+// move inline ID's data out to a sector near HINT and make it an
+// ordinary tree-format inode
+static bool inline_to_tree(struct inode_disk *id, block_sector_t hint){
+  block_sector_t sector = 0;
+  if (id->length > 0){
+    if (!free_map_allocate_near (1, hint, &sector))
+      return false;
+    cached_write (sector, 0, zeros, BLOCK_SECTOR_SIZE);
+    cached_write (sector, 0, id->inline_data, id->length);
   }
+  memset (id->inline_data, 0, sizeof id->inline_data);
+  id->direct[0] = sector;
+  id->flags &= ~INODE_INLINE;
+  return true;
+}
 
-  for (i=0;i<128;i++){
-    if (double_buffer[i] == 0 && size <= num_resized_block * BLOCK_SECTOR_SIZE) {
+// grow ID to SIZE bytes, placing any new sectors close after
+// HINT, normally the sector holding ID itself.  files never
+// shrink.
+bool inode_resize_near(struct inode_disk *id, off_t size, block_sector_t hint){
+  bool success;
+  ASSERT (size >= id->length);
+  free_map_defer ();
+  if (id->flags & INODE_EXTENTS)
+    success = extent_resize (id, size, hint);
+  else {
+    // tree-format files are sparse: growing only moves the end,
+    // and sectors are allocated as they are first written
+    success = true;
+    if ((id->flags & INODE_INLINE) && size > INODE_INLINE_SIZE)
+      success = inline_to_tree (id, hint);
+    if (success)
       id->length = size;
-      break;
-    }
-    if (size > (num_resized_block) * BLOCK_SECTOR_SIZE){
-      if(!inode_resize_indirect(id,size,num_resized_block,&double_buffer[i],indirect_buffer)){
-        free(double_buffer);
-        return false;
-      }     
-    }
-    num_resized_block+=128;
   }
-
-  cached_write(id->doubly_indirect,0,double_buffer,BLOCK_SECTOR_SIZE);
-  free(double_buffer);
-  free(indirect_buffer);
-  id->length = size;
-  return true;
+  free_map_commit ();
+  return success;
 }
 
 int get_cache_hit_rate () {
@@ -644,6 +2197,31 @@ long long get_cache_write_cnt () {
   return get_device_write_cnt (fs_device);
 }
 
+void cache_get_stats (struct cache_stats *stats) {
+  stats->hits = hits;
+  stats->misses = misses;
+  stats->device_reads = get_device_read_cnt (fs_device);
+  stats->device_writes = get_device_write_cnt (fs_device);
+  stats->device_write_reqs = get_device_write_req_cnt (fs_device);
+  stats->flushes = flushes;
+  stats->sync_writes = sync_writes;
+  stats->stalls_avoided = stalls_avoided;
+  stats->readaheads = readaheads;
+  stats->direct_reads = direct_reads;
+  stats->direct_writes = direct_writes;
+  stats->free_map_writes = free_map_write_cnt ();
+  stats->free_map_sectors = free_map_sector_write_cnt ();
+  stats->free_map_allocs = free_map_alloc_cnt ();
+  stats->free_map_scanned = free_map_scan_cnt ();
+  stats->free_sectors = free_map_free_cnt ();
+  stats->reclaims_queued = reclaims_queued;
+  stats->journal_commits = journal_commit_cnt ();
+  stats->journal_blocks = journal_block_cnt ();
+  stats->journal_overflows = journal_overflow_cnt ();
+  stats->index_lookups = index_lookups;
+  stats->index_compares = index_compares;
+}
+
 void inode_close_indirect(block_sector_t indirect,block_sector_t* indirect_buffer){
   int i;
   if (indirect!=0){
@@ -655,46 +2233,208 @@ void inode_close_indirect(block_sector_t indirect,block_sector_t* indirect_buffe
   }
 }
 
-bool create_data_block_indirect(int num, block_sector_t indirect, block_sector_t* indirect_buffer){
+// Indirect blocks inode_close_indirect_many() reads at once.
+#define CLOSE_BATCH 16
+
+// like inode_close_indirect() for each of the CNT blocks in
+// INDIRECT, but reads them from the cache CLOSE_BATCH at a time.
+// falls back to one at a time in INDIRECT_BUFFER if memory is short.
+void inode_close_indirect_many(const block_sector_t *indirect,int cnt,block_sector_t* indirect_buffer){
+  struct cache_io ios[CLOSE_BATCH];
+  block_sector_t *batch = malloc (CLOSE_BATCH * BLOCK_SECTOR_SIZE);
+  int i, j, k, io_cnt;
+
+  if (batch == NULL){
+    for (i=0;i<cnt;i++)
+      inode_close_indirect(indirect[i],indirect_buffer);
+    return;
+  }
+  for (i=0;i<cnt;i+=CLOSE_BATCH){
+    io_cnt = 0;
+    for (j=i;j<cnt && j<i+CLOSE_BATCH;j++){
+      if (indirect[j]==0)
+        continue;
+      ios[io_cnt].sector = indirect[j];
+      ios[io_cnt].ofs = 0;
+      ios[io_cnt].buffer = batch + io_cnt * 128;
+      ios[io_cnt].size = BLOCK_SECTOR_SIZE;
+      io_cnt++;
+    }
+    cached_read_many (ios, io_cnt);
+    for (j=0;j<io_cnt;j++){
+      const block_sector_t *entries = ios[j].buffer;
+      for (k=0;k<128;k++)
+        if (entries[k]!=0)
+          free_map_release (entries[k], 1);
+      free_map_release (ios[j].sector, 1);
+    }
+  }
+  free (batch);
+}
+
+bool create_data_block_indirect(int num, block_sector_t indirect, block_sector_t* indirect_buffer, struct sector_pool *pool){
   int i;
   memset (indirect_buffer, 0, BLOCK_SECTOR_SIZE);
   for (i=0;i<num;i++){
-    if (!free_map_allocate (1, &(indirect_buffer[i]))){
+    if (!pool_take_data (pool, &(indirect_buffer[i]))){
       return false;
     }      
   }
-  cached_write(indirect,0,indirect_buffer,BLOCK_SECTOR_SIZE);
+  cached_write_meta(indirect,0,indirect_buffer,BLOCK_SECTOR_SIZE);
   return true;
 }
 
-bool inode_resize_indirect(struct inode_disk *id,int size,int num_resized_block,block_sector_t* indirect,block_sector_t* indirect_buffer){
-  int i;
-  if (*indirect == 0){
-    if (!free_map_allocate (1, indirect)){
-      *indirect = 0;
-      inode_resize(id, id->length);
-      free(indirect_buffer);
-      return false;        
-    }
-    memset(indirect_buffer,0,BLOCK_SECTOR_SIZE);    
-  }else{
-    cached_read(*indirect,0,indirect_buffer,BLOCK_SECTOR_SIZE);
-  }
-
-  for (i = 0; i < 128; i++){
-    if (size <= (num_resized_block+i) * BLOCK_SECTOR_SIZE && indirect_buffer[i]!=0){
-      free_map_release (indirect_buffer[i],1);
-      indirect_buffer[i] = 0;
-    }
-    if (size > (num_resized_block+i) * BLOCK_SECTOR_SIZE && indirect_buffer[i]==0){
-      if (!free_map_allocate (1, &indirect_buffer[i])){
-        *indirect = 0;
-        inode_resize(id, id->length);
-        free(indirect_buffer);
-        return false;        
-      }      
-    }    
-  }
-  cached_write(*indirect,0,indirect_buffer,BLOCK_SECTOR_SIZE);
+/* Returns the number of file sectors ID's extents cover, which
+   may be more than its length calls for. */
+static size_t
+extent_capacity (const struct inode_disk *id)
+{
+  const struct inode_extent *last;
+  if (id->extent_cnt == 0)
+    return 0;
+  last = &id->extents[id->extent_cnt - 1];
+  return last->file_block + last->length;
+}
+
+/* Appends the CNT sectors starting at START to ID's extents,
+   merging them into the last extent if they continue it.
+   Returns false if ID has no free extent. */
+static bool
+extent_append (struct inode_disk *id, block_sector_t start, size_t cnt)
+{
+  struct inode_extent *e;
+  if (id->extent_cnt > 0)
+    {
+      e = &id->extents[id->extent_cnt - 1];
+      if (e->start + e->length == start)
+        {
+          e->length += cnt;
+          return true;
+        }
+    }
+  if (id->extent_cnt == INODE_EXTENT_CNT)
+    return false;
+  e = &id->extents[id->extent_cnt];
+  e->file_block = extent_capacity (id);
+  id->extent_cnt++;
+  e->start = start;
+  e->length = cnt;
+  return true;
+}
+
+/* Zeroes the CNT sectors starting at START.
+   Returns false if memory runs out. */
+static bool
+extent_zero (block_sector_t start, size_t cnt)
+{
+  block_sector_t *sectors = malloc (cnt * sizeof *sectors);
+  bool success;
+  size_t i;
+
+  if (sectors == NULL)
+    return false;
+  for (i = 0; i < cnt; i++)
+    sectors[i] = start + i;
+  success = zero_sectors (sectors, cnt);
+  free (sectors);
+  return success;
+}
+
+/* Grows extent-format inode ID to SIZE bytes.  Space is taken a
+   run at a time with free_map_allocate(), first asking for as
+   much again as the file already has, up to
+   EXTENT_PREALLOC_MAX sectors more, so that a growing file needs
+   few extents, then for exactly what is missing, halving the
+   request until the free map can satisfy it.  New sectors are
+   zeroed, so a write past the end leaves zeros in the gap.
+   Sectors past the end of the file stay allocated until
+   extent_trim() gives them back when the file is closed.
+   Returns false if the disk or ID's extents run out. */
+static bool
+extent_resize (struct inode_disk *id, off_t size, block_sector_t hint)
+{
+  size_t have = extent_capacity (id);
+  size_t need = bytes_to_sectors (size);
+  size_t cnt = need > have ? need - have : 0;
+
+  if (cnt < have)
+    cnt = have < cnt + EXTENT_PREALLOC_MAX ? have : cnt + EXTENT_PREALLOC_MAX;
+
+  while (have < need)
+    {
+      block_sector_t start;
+      if (id->extent_cnt > 0)
+        hint = id->extents[id->extent_cnt - 1].start
+               + id->extents[id->extent_cnt - 1].length;
+      if (!free_map_allocate_near (cnt, hint, &start))
+        {
+          if (cnt > need - have)
+            cnt = need - have;
+          else if (cnt > 1)
+            cnt /= 2;
+          else
+            return false;
+          continue;
+        }
+      if (!extent_zero (start, cnt) || !extent_append (id, start, cnt))
+        {
+          free_map_release (start, cnt);
+          return false;
+        }
+      have += cnt;
+      cnt = need > have ? need - have : 0;
+    }
+  if (size > id->length)
+    id->length = size;
   return true;
 }
+
+/* Releases the sectors of extent-format inode ID that lie past
+   the end of its data. */
+static void
+extent_trim (struct inode_disk *id)
+{
+  size_t need = bytes_to_sectors (id->length);
+
+  while (id->extent_cnt > 0)
+    {
+      struct inode_extent *e = &id->extents[id->extent_cnt - 1];
+      size_t keep = need > e->file_block ? need - e->file_block : 0;
+
+      if (keep >= e->length)
+        break;
+      free_map_release (e->start + keep, e->length - keep);
+      if (keep > 0)
+        {
+          e->length = keep;
+          break;
+        }
+      memset (e, 0, sizeof *e);
+      id->extent_cnt--;
+    }
+}
+
+/* Returns the disk sector holding FILE_BLOCK of extent-format
+   inode ID, found by binary search over its extents, or 0 if the
+   extents do not cover FILE_BLOCK. */
+static block_sector_t
+extent_to_sector (const struct inode_disk *id, size_t file_block)
+{
+  const struct inode_extent *e;
+  size_t lo = 0, hi = id->extent_cnt;
+
+  while (hi - lo > 1)
+    {
+      size_t mid = (lo + hi) / 2;
+      if (id->extents[mid].file_block <= file_block)
+        lo = mid;
+      else
+        hi = mid;
+    }
+  if (hi == 0)
+    return 0;
+  e = &id->extents[lo];
+  if (file_block < e->file_block || file_block >= e->file_block + e->length)
+    return 0;
+  return e->start + (file_block - e->file_block);
+}
@@ -3,6 +3,9 @@
 
 #include <stdbool.h>
 #include <list.h>
+#include <hash.h>
+#include <cache-stats.h>
+#include <uio.h>
 #include <debug.h>
 #include <round.h>
 #include <string.h>
@@ -15,49 +18,175 @@
 
 struct bitmap;
 
+/* Sectors taken from the free map in one batch for growing a
+   tree-format inode, handed out one at a time as the tree is
+   filled in.  See pool_init() in inode.c. */
+struct sector_pool
+  {
+    block_sector_t *sectors;            /* Data sectors, then pointer blocks. */
+    size_t data_cnt, data_next;         /* Data sectors, next to hand out. */
+    size_t meta_cnt, meta_next;         /* Pointer blocks, next to hand out. */
+  };
+
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
-#define CACHE_SIZE 64
+
+/* Number of buffer cache slots used unless "-cache=N" is given
+   on the kernel command line. */
+#define CACHE_DEFAULT_SIZE 64
+
+/* Buffer cache replacement policies, chosen with kernel
+   command-line option "-cache-policy=NAME". */
+enum cache_policy
+  {
+    CACHE_CLOCK,                /* "clock": one reference bit. */
+    CACHE_2Q                    /* "2q": scan resistant, and keeps
+                                   metadata ahead of file data. */
+  };
+
+/* Queues of the 2Q policy. */
+#define CACHE_A1 0              /* Seen once: evicted first, FIFO. */
+#define CACHE_AM 1              /* Seen again, or metadata: clock. */
+
+/* Read-ahead window bounds, in sectors.  A sequential reader
+   starts at RA_MIN_WINDOW and doubles on every sequential read,
+   up to RA_MAX_WINDOW or a quarter of the cache. */
+#define RA_MIN_WINDOW 4
+#define RA_MAX_WINDOW 32
+
+/* Sector numbers held by one indirect block. */
+#define INODE_PTRS_PER_BLOCK (BLOCK_SECTOR_SIZE / sizeof (block_sector_t))
+
+/* File sectors a tree-format inode reaches through its direct,
+   indirect and doubly indirect pointers.  The rest are reached
+   through triply_indirect. */
+#define INODE_TRIPLY_START (112 + 128 + 128 * 128)
+
+/* Largest file a tree-format inode can hold, in bytes: a little
+   over 1 GB, which still fits in an off_t. */
+#define INODE_MAX_LENGTH \
+  ((off_t) (INODE_TRIPLY_START + 128 * 128 * 128) * BLOCK_SECTOR_SIZE)
+
+/* Bits in inode_disk.flags. */
+#define INODE_EXTENTS 0x1               /* Data is in extents[]. */
+#define INODE_INLINE 0x2                /* Data is in inline_data[]. */
+
+/* Bytes of data a tree-format inode can hold in its own sector,
+   in place of its block pointers. */
+#define INODE_INLINE_SIZE 456
+
+/* Extents held by an extent-format inode. */
+#define INODE_EXTENT_CNT 38
+
+/* A run of LENGTH contiguous disk sectors, starting at START,
+   that holds the file's sectors FILE_BLOCK onward. */
+struct inode_extent
+  {
+    uint32_t file_block;                /* First file sector in run. */
+    block_sector_t start;               /* First disk sector in run. */
+    uint32_t length;                    /* Sectors in run. */
+  };
 
 /* On-disk inode.
    Must be exactly BLOCK_SECTOR_SIZE bytes long. */
 struct inode_disk
   {
-    block_sector_t direct[112];          /* 12 direct pointers */
-    block_sector_t indirect;            /* singly indirect pointer */
-    block_sector_t doubly_indirect;     /* doubly indirect pointer */
+    union
+      {
+        struct
+          {
+            block_sector_t direct[112];          /* 12 direct pointers */
+            block_sector_t indirect;            /* singly indirect pointer */
+            block_sector_t doubly_indirect;     /* doubly indirect pointer */
+          };
+        /* Sorted by file_block, if INODE_EXTENTS is set. */
+        struct inode_extent extents[INODE_EXTENT_CNT];
+        /* The file's bytes, if INODE_INLINE is set. */
+        uint8_t inline_data[INODE_INLINE_SIZE];
+      };
     off_t length;                       /* File size in bytes. */
     unsigned magic;                     /* Magic number. */
-    uint32_t unused[12];               /* Not used. */
+    uint32_t flags;                     /* INODE_* bits. */
+    uint32_t extent_cnt;                /* Extents in use. */
+    block_sector_t triply_indirect;     /* triply indirect pointer */
+    uint32_t unused[9];                 /* Not used. */
   };
 
+/* If true, new inodes use extents instead of the pointer tree.
+   Controlled by kernel command-line option "-extents". */
+extern bool inode_use_extents;
+
 /* In-memory inode. */
 struct inode
   {
-    struct list_elem elem;              /* Element in inode list. */
+    struct hash_elem elem;              /* Element in open inode table. */
     block_sector_t sector;              /* Sector number of disk location. */
     int open_cnt;                       /* Number of openers. */
+    bool loading;                       /* Sector still being read? */
+    struct condition loaded;            /* Signaled when it has been. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    bool metadata;                      /* Data is journaled metadata? */
+    bool map_dirty;                     /* Length or block map changed
+                                           since the last sync? */
+    struct list dirty_blocks;           /* Dirty cached data blocks. */
     struct inode_disk data;             /* Inode content. */
-    struct semaphore sema;              /* Lock used to to provide mutual 
-                                          exclusion on files and directories */
+    struct rwlock rw;                   /* Shared for reads and writes in
+                                           place, exclusive to grow. */
+    struct lock ra_lock;                /* Protects the ra_* members. */
+    off_t ra_next;                      /* Offset a sequential read starts at. */
+    size_t ra_end;                      /* First sector not yet read ahead. */
+    int ra_window;                      /* Read-ahead sectors, 0 if random. */
+    struct lock map_lock;               /* Protects the map_* members. */
+    bool map_top_valid;                 /* map_top holds doubly_indirect? */
+    block_sector_t map_leaf_sector;     /* Block copied into map_leaf. */
+    int map_mid_idx;                    /* triply_indirect entry in map_mid. */
+    block_sector_t map_top[INODE_PTRS_PER_BLOCK];  /* Copy of doubly_indirect. */
+    block_sector_t map_mid[INODE_PTRS_PER_BLOCK];  /* Copy of a block under
+                                                      triply_indirect. */
+    block_sector_t map_leaf[INODE_PTRS_PER_BLOCK]; /* Last indirect block used. */
+  };
+
+/* One piece of a cached_read_many() or cached_write_many():
+   SIZE bytes at byte offset OFS within SECTOR, copied to or from
+   BUFFER. */
+struct cache_io
+  {
+    block_sector_t sector;              /* Sector to read or write. */
+    int ofs;                            /* Byte offset within SECTOR. */
+    void *buffer;                       /* Caller's side of the copy. */
+    int size;                           /* Bytes to copy. */
   };
 
 struct cached_block {
     int clock;                          /* Used for clock algorithm evicition */
     int valid;                          /* tracks cache block validity */
     int dirty;                          /* Tracks changes to cache block not written to disk */
+    int flushed;                        /* Cleaned by the flusher since last written */
+    int journaled;                      /* Pinned until the journal commits it */
+    int meta;                           /* Last used as metadata */
+    int queue;                          /* CACHE_A1 or CACHE_AM, under 2Q */
+    struct list_elem a1_elem;           /* Element in the 2Q A1 queue */
+    struct inode *owner;                /* Open inode whose dirty data this is */
+    struct list_elem dirty_elem;        /* Element in owner's dirty_blocks */
     block_sector_t sector;              /* The sector storing the data */
     uint8_t* data;                      /* size : [BLOCK_SECTOR_SIZE] */
     struct lock cache_block_lock;
+    struct hash_elem hash_elem;         /* Element in the sector -> slot index */
 };
-struct cached_block Cache[CACHE_SIZE];
+
+/* Buffer cache slots, CACHE_SIZE of them.  Sized at boot by
+   cache_init() and allocated from the kernel page pool. */
+extern struct cached_block *Cache;
+extern size_t cache_size;
+extern enum cache_policy cache_policy;
+#define CACHE_SIZE ((int) cache_size)
 int min(int a, int b);
 
 
 void inode_init (void);
 bool inode_create (block_sector_t, off_t);
+bool inode_create_full (block_sector_t, off_t);
 struct inode *inode_open (block_sector_t);
 struct inode *inode_reopen (struct inode *);
 block_sector_t inode_get_inumber (const struct inode *);
@@ -65,42 +194,68 @@ void inode_close (struct inode *);
 void inode_remove (struct inode *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
+off_t inode_read_direct_at (struct inode *, void *, off_t size, off_t offset);
+off_t inode_write_direct_at (struct inode *, const void *, off_t size,
+                             off_t offset);
+off_t inode_readv_at (struct inode *, const struct iovec *, int iovcnt,
+                      off_t offset, bool direct);
+off_t inode_writev_at (struct inode *, const struct iovec *, int iovcnt,
+                       off_t offset, bool direct);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
 off_t inode_length (const struct inode *);
+bool inode_is_sparse (const struct inode *);
+void inode_set_metadata (struct inode *);
+void inode_sync (struct inode *, bool data_only);
 
 
 // cache helper function
 void cache_init (void);
-void cached_read(block_sector_t sector, int sector_ofs, const void* buffer, int size);
+void cache_done (void);
+void cache_flush (void);
+void cache_flusher (void *aux);
+void cache_tick (int64_t now);
+void cache_readahead (void *aux);
+void inode_reclaimer (void *aux);
+bool inode_reclaim_one (void);
+bool inode_reclaim_held (void);
+void inode_reclaim_all (void);
+void cached_read(block_sector_t sector, int sector_ofs, void* buffer, int size);
+void cached_read_data(block_sector_t sector, int sector_ofs, void* buffer, int size);
+void cached_read_many(struct cache_io *ios, size_t cnt);
+void cached_write_many(struct cache_io *ios, size_t cnt);
 void cached_write(block_sector_t sector, int sector_ofs, const void* buffer, int size);
+void cached_write_data(struct inode *inode, block_sector_t sector, int sector_ofs, const void* buffer, int size);
+void cached_write_meta(block_sector_t sector, int sector_ofs, const void* buffer, int size);
+bool cache_log_block(block_sector_t sector, block_sector_t log_sector);
+void cache_unpin_block(block_sector_t sector, bool home);
+void direct_read(block_sector_t sector, void* buffer);
+void direct_write(block_sector_t sector, const void* buffer);
 int  sector_num_to_cache_idx(const block_sector_t );
 int  block_in_cache(const block_sector_t sector);
 
 int  evict_and_overwrite(block_sector_t sector);
-void evict_cache(int i);
 
 // cache sync helper function
 void acquire_lock_for_cache_block(int cache_idx);
 void release_lock_for_cache_block(int cache_idx);
-void acquire_lock_for_evicting(void);
-void release_lock_for_evicting(void);
 int get_cache_hit_rate (void);
 int get_cache_hits (void);
 int get_cache_misses (void);
 void clear_cache_hit_rate (void);
 long long get_cache_write_cnt (void);
+void cache_get_stats (struct cache_stats *);
 
 
 // task 2 helper functions
-bool inode_resize(struct inode_disk *inode, off_t size);
-bool create_data_block(int num,struct inode_disk *disk_inode);
+bool inode_resize_near(struct inode_disk *inode, off_t size, block_sector_t hint);
+bool create_data_block(int num,struct inode_disk *disk_inode,block_sector_t hint);
 
 
 // helper functions given an indirect pointer
 void inode_close_indirect(block_sector_t indirect,block_sector_t* indirect_buffer);
-bool create_data_block_indirect(int num,block_sector_t indirect,block_sector_t* indirect_buffer);
-bool inode_resize_indirect(struct inode_disk *id,int size,int num_resized_block,block_sector_t* indirect,block_sector_t* indirect_buffer);
+void inode_close_indirect_many(const block_sector_t *indirect,int cnt,block_sector_t* indirect_buffer);
+bool create_data_block_indirect(int num,block_sector_t indirect,block_sector_t* indirect_buffer,struct sector_pool *pool);
 bool old_inode_create (block_sector_t, off_t);
 
 #endif /* filesys/inode.h */
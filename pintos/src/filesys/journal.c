@@ -0,0 +1,266 @@
+#include "filesys/journal.h"
+#include <debug.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "filesys/filesys.h"
+#include "filesys/inode.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* A redo journal for file system metadata: inode sectors,
+   pointer blocks, directory contents and the free map.
+
+   Every operation that may change metadata runs between
+   journal_begin() and journal_end().  The sectors it changes
+   join the running transaction and stay pinned in the buffer
+   cache, so that none of them reaches its home on disk early.
+   A commit waits until no operation is running, writes an image
+   of every sector in the transaction to the journal, then the
+   header that names them, which is the commit point.  Only then
+   are the sectors written home, after which the header is
+   cleared.  At boot, a header that still names sectors means a
+   crash came after a commit point, so its images are copied
+   home again.
+
+   The flusher commits every time it runs, so the metadata
+   changes of many operations go to disk in one sequential
+   write.  An operation that finds the transaction half full
+   commits it before starting, which leaves the other half for
+   the operation's own changes.  Sectors beyond that are written
+   without the journal, like file data always is. */
+
+#define JOURNAL_MAGIC 0x4c4e524a        /* Identifies the header. */
+
+/* Journal header, in sector JOURNAL_SECTOR.  Image I of a
+   commit is in sector JOURNAL_SECTOR + 1 + I. */
+struct journal_header
+  {
+    uint32_t magic;                     /* JOURNAL_MAGIC. */
+    uint32_t seq;                       /* Commits so far. */
+    uint32_t cnt;                       /* Images to replay, if any. */
+    block_sector_t sectors[JOURNAL_BLOCKS]; /* Home of each image. */
+    uint8_t unused[BLOCK_SECTOR_SIZE - 12 - 4 * JOURNAL_BLOCKS];
+  };
+
+/* The running transaction. */
+static block_sector_t txn[JOURNAL_BLOCKS];  /* Sectors in it. */
+static size_t txn_cnt;                  /* Number of sectors in it. */
+static size_t txn_cap;                  /* Most sectors it may pin. */
+static struct lock txn_lock;            /* Protects txn and txn_cnt. */
+
+/* Held shared by running operations, exclusive by commits. */
+static struct rwlock ops;
+
+static struct journal_header header;    /* Last header written. */
+static bool crashed;                    /* journal_crash() called? */
+static unsigned commit_cnt;             /* Commits written. */
+static unsigned block_cnt;              /* Images written. */
+static unsigned overflow_cnt;           /* Sectors left out of a
+                                           full transaction. */
+
+static void commit (bool crash);
+
+/* Orders sector numbers. */
+static int
+compare_sectors (const void *a_, const void *b_)
+{
+  const block_sector_t *a = a_;
+  const block_sector_t *b = b_;
+  return *a < *b ? -1 : *a > *b;
+}
+
+/* Initializes the journal.  If FORMAT is true, writes an empty
+   journal; otherwise replays the last commit if a crash kept it
+   from reaching home. */
+void
+journal_init (bool format)
+{
+  ASSERT (sizeof header == BLOCK_SECTOR_SIZE);
+
+  lock_init (&txn_lock);
+  rwlock_init (&ops);
+  txn_cap = cache_size / 2;
+  if (txn_cap > JOURNAL_BLOCKS)
+    txn_cap = JOURNAL_BLOCKS;
+
+  block_read (fs_device, JOURNAL_SECTOR, &header);
+  if (format || header.magic != JOURNAL_MAGIC)
+    {
+      memset (&header, 0, sizeof header);
+      header.magic = JOURNAL_MAGIC;
+    }
+  else if (header.cnt > 0 && header.cnt <= JOURNAL_BLOCKS)
+    {
+      uint8_t *buffer = malloc (BLOCK_SECTOR_SIZE);
+      uint32_t i;
+
+      if (buffer == NULL)
+        PANIC ("can't allocate journal replay buffer");
+      printf ("Replaying %u journaled sectors...\n", (unsigned) header.cnt);
+      for (i = 0; i < header.cnt; i++)
+        {
+          block_read (fs_device, JOURNAL_SECTOR + 1 + i, buffer);
+          block_write (fs_device, header.sectors[i], buffer);
+        }
+      free (buffer);
+    }
+  header.cnt = 0;
+  block_write (fs_device, JOURNAL_SECTOR, &header);
+}
+
+/* Starts an operation that may change metadata.  Calls nest;
+   only the outermost one waits for a commit in progress, and it
+   first commits the running transaction if it is half full.
+   The caller must hold no file system lock that an operation
+   could be waiting on, since a commit waits for every running
+   operation to finish. */
+void
+journal_begin (void)
+{
+  struct thread *t = thread_current ();
+  bool full;
+
+  if (t->journal_depth > 0)
+    {
+      t->journal_depth++;
+      return;
+    }
+  lock_acquire (&txn_lock);
+  full = txn_cnt > 0 && txn_cnt >= txn_cap / 2;
+  lock_release (&txn_lock);
+  if (full)
+    journal_commit ();
+  t->journal_depth++;
+  rwlock_acquire_read (&ops);
+}
+
+/* Ends an operation started by journal_begin(). */
+void
+journal_end (void)
+{
+  struct thread *t = thread_current ();
+
+  ASSERT (t->journal_depth > 0);
+  if (--t->journal_depth == 0)
+    rwlock_release_read (&ops);
+}
+
+/* Adds SECTOR, about to be changed, to the running transaction.
+   Returns true if the caller must pin SECTOR's cache block until
+   the next commit, false if SECTOR is to be written like any
+   other, because the running thread is not in an operation or
+   the transaction is full. */
+bool
+journal_add (block_sector_t sector)
+{
+  bool added = false;
+  size_t i;
+
+  if (thread_current ()->journal_depth == 0 || crashed)
+    return false;
+  lock_acquire (&txn_lock);
+  for (i = 0; i < txn_cnt; i++)
+    if (txn[i] == sector)
+      {
+        added = true;
+        break;
+      }
+  if (!added && txn_cnt < txn_cap)
+    {
+      txn[txn_cnt++] = sector;
+      added = true;
+    }
+  else if (!added)
+    overflow_cnt++;
+  lock_release (&txn_lock);
+  return added;
+}
+
+/* Commits the running transaction and writes its sectors home.
+   Must not be called inside an operation. */
+void
+journal_commit (void)
+{
+  commit (false);
+}
+
+/* Simulates a crash for testing: commits the running
+   transaction but writes only every other sector of it home,
+   and stops committing, as if power failed partway through.
+   The next boot must replay the commit to repair the metadata. */
+void
+journal_crash (void)
+{
+  commit (true);
+}
+
+/* Writes the running transaction to the journal and then home,
+   or only partly home if CRASH is true. */
+static void
+commit (bool crash)
+{
+  size_t i, n;
+
+  ASSERT (thread_current ()->journal_depth == 0);
+  rwlock_acquire_write (&ops);
+  if (crashed || txn_cnt == 0)
+    {
+      crashed = crashed || crash;
+      rwlock_release_write (&ops);
+      return;
+    }
+
+  /* Write the images, then the header naming them. */
+  qsort (txn, txn_cnt, sizeof *txn, compare_sectors);
+  for (i = n = 0; i < txn_cnt; i++)
+    if (cache_log_block (txn[i], JOURNAL_SECTOR + 1 + n))
+      header.sectors[n++] = txn[i];
+  header.seq++;
+  header.cnt = n;
+  block_write (fs_device, JOURNAL_SECTOR, &header);
+  commit_cnt++;
+  block_cnt += n;
+
+  if (crash)
+    {
+      for (i = 0; i < txn_cnt; i += 2)
+        cache_unpin_block (txn[i], true);
+      crashed = true;
+    }
+  else
+    {
+      /* Write the sectors home.  Once they are there the commit
+         must not be replayed, or it could overwrite a sector
+         that has since been freed and reused for file data. */
+      for (i = 0; i < txn_cnt; i++)
+        cache_unpin_block (txn[i], true);
+      header.cnt = 0;
+      block_write (fs_device, JOURNAL_SECTOR, &header);
+      txn_cnt = 0;
+    }
+  rwlock_release_write (&ops);
+}
+
+/* Returns the number of commits written. */
+unsigned
+journal_commit_cnt (void)
+{
+  return commit_cnt;
+}
+
+/* Returns the number of sector images written to the journal. */
+unsigned
+journal_block_cnt (void)
+{
+  return block_cnt;
+}
+
+/* Returns the number of times a sector was written without the
+   journal because the running transaction was full. */
+unsigned
+journal_overflow_cnt (void)
+{
+  return overflow_cnt;
+}
@@ -0,0 +1,24 @@
+#ifndef FILESYS_JOURNAL_H
+#define FILESYS_JOURNAL_H
+
+#include <stdbool.h>
+#include "devices/block.h"
+
+/* Sectors set aside at format time for the metadata journal: a
+   header sector, then room for JOURNAL_BLOCKS sector images. */
+#define JOURNAL_SECTOR 2                /* Journal header sector. */
+#define JOURNAL_BLOCKS 64               /* Most sectors per commit. */
+#define JOURNAL_SECTORS (1 + JOURNAL_BLOCKS)
+
+void journal_init (bool format);
+void journal_begin (void);
+void journal_end (void);
+bool journal_add (block_sector_t);
+void journal_commit (void);
+void journal_crash (void);
+
+unsigned journal_commit_cnt (void);
+unsigned journal_block_cnt (void);
+unsigned journal_overflow_cnt (void);
+
+#endif /* filesys/journal.h */
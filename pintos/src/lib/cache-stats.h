@@ -0,0 +1,39 @@
+#ifndef __LIB_CACHE_STATS_H
+#define __LIB_CACHE_STATS_H
+
+/* File system buffer cache statistics, plus a few counters from
+   the rest of the file system, filled in by the cache_stats()
+   system call.  Counters start at zero at boot. */
+struct cache_stats
+  {
+    unsigned hits;              /* Lookups that found their sector. */
+    unsigned misses;            /* Lookups that had to read the disk. */
+    unsigned device_reads;      /* Sectors read from the device. */
+    unsigned device_writes;     /* Sectors written to the device. */
+    unsigned device_write_reqs; /* Write requests those took. */
+    unsigned flushes;           /* Dirty blocks written by the flusher. */
+    unsigned sync_writes;       /* Dirty blocks written by fsync() and
+                                   fdatasync(). */
+    unsigned stalls_avoided;    /* Evictions of blocks the flusher had
+                                   already cleaned. */
+    unsigned readaheads;        /* Sectors brought in by read-ahead. */
+    unsigned direct_reads;      /* Sectors read around the cache. */
+    unsigned direct_writes;     /* Sectors written around the cache. */
+    unsigned free_map_writes;   /* Times the free map was written. */
+    unsigned free_map_sectors;  /* Free map file sectors written. */
+    unsigned free_map_allocs;   /* Free map allocations. */
+    unsigned free_map_scanned;  /* Free map bits those examined. */
+    unsigned free_sectors;      /* Sectors not in use right now. */
+    unsigned reclaims_queued;   /* Removed inodes handed to the
+                                   reclaimer thread. */
+    unsigned journal_commits;   /* Metadata journal commits. */
+    unsigned journal_blocks;    /* Sectors written to the journal. */
+    unsigned journal_overflows; /* Metadata sectors written without
+                                   the journal, which was full. */
+    unsigned index_lookups;     /* Searches of the cache's sector
+                                   index. */
+    unsigned index_compares;    /* Sector comparisons those and index
+                                   inserts made. */
+  };
+
+#endif /* lib/cache-stats.h */
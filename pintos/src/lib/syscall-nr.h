@@ -33,7 +33,18 @@ enum
 
     /* Cache stats */
     SYS_CACHE_HITRATE,          /* Returns the cache hit rate */    
-    SYS_CACHE_WRITE_CNT         /* Gets cache write cnt */
+    SYS_CACHE_WRITE_CNT,        /* Gets cache write cnt */
+    SYS_CACHE_STATS,            /* Copies out cache statistics */
+    SYS_OPEN_DIRECT,            /* Opens a file for direct I/O */
+    SYS_CRASH,                  /* Leaves the disk as if power failed */
+    SYS_FSYNC,                  /* Writes a file and its metadata out */
+    SYS_FDATASYNC,              /* Writes a file's data out */
+    SYS_PREAD,                  /* Reads at a given offset */
+    SYS_PWRITE,                 /* Writes at a given offset */
+    SYS_READV,                  /* Reads into several buffers */
+    SYS_WRITEV,                 /* Writes from several buffers */
+    SYS_PREADV,                 /* readv() at a given offset */
+    SYS_PWRITEV                 /* writev() at a given offset */
   };
 
 #endif /* lib/syscall-nr.h */
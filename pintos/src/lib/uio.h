@@ -0,0 +1,18 @@
+#ifndef __LIB_UIO_H
+#define __LIB_UIO_H
+
+#include <stddef.h>
+
+/* One buffer of a vectored read or write: readv(), writev(),
+   preadv() and pwritev() transfer to or from each buffer of an
+   array of these in turn. */
+struct iovec
+  {
+    void *iov_base;             /* Start of the buffer. */
+    size_t iov_len;             /* Bytes in the buffer. */
+  };
+
+/* Most buffers one vectored read or write may name. */
+#define IOV_MAX 64
+
+#endif /* lib/uio.h */
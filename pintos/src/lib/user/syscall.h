@@ -3,6 +3,8 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <cache-stats.h>
+#include <uio.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -27,6 +29,7 @@ int wait (pid_t);
 bool create (const char *file, unsigned initial_size);
 bool remove (const char *file);
 int open (const char *file);
+int open_direct (const char *file);
 int filesize (int fd);
 int read (int fd, void *buffer, unsigned length);
 int write (int fd, const void *buffer, unsigned length);
@@ -47,5 +50,15 @@ bool isdir (int fd);
 int inumber (int fd);
 int cache_hitrate (void);
 long long cache_write_cnt (void);
+void cache_stats (struct cache_stats *);
+void crash (void);
+int fsync (int fd);
+int fdatasync (int fd);
+int pread (int fd, void *buffer, unsigned length, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned offset);
+int readv (int fd, const struct iovec *, int iovcnt);
+int writev (int fd, const struct iovec *, int iovcnt);
+int preadv (int fd, const struct iovec *, int iovcnt, unsigned offset);
+int pwritev (int fd, const struct iovec *, int iovcnt, unsigned offset);
 
 #endif /* lib/user/syscall.h */
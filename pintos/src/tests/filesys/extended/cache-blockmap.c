@@ -0,0 +1,52 @@
+/* Reads a file large enough to need both the indirect and the
+   doubly indirect block, in one call.  Each sector number is
+   looked up through those blocks, but they are kept with the
+   open inode, so the buffer cache should see little more than
+   one lookup per data sector. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SECTOR_SIZE 512
+#define SECTOR_CNT 400
+
+/* Lookups allowed beyond one per data sector: the indirect
+   block, the doubly indirect block and its leaves. */
+#define SLACK 8
+
+static char buf[SECTOR_CNT * SECTOR_SIZE];
+static char actual[SECTOR_CNT * SECTOR_SIZE];
+
+void
+test_main (void)
+{
+  const char *file_name = "big-file";
+  struct cache_stats before, after;
+  unsigned lookups;
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  random_bytes (buf, sizeof buf);
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf,
+         "write %d sectors", SECTOR_CNT);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  cache_stats (&before);
+  CHECK (read (fd, actual, sizeof actual) == sizeof actual,
+         "read %d sectors", SECTOR_CNT);
+  cache_stats (&after);
+  compare_bytes (actual, buf, sizeof actual, 0, file_name);
+
+  lookups = (after.hits - before.hits) + (after.misses - before.misses);
+  CHECK (lookups <= SECTOR_CNT + SLACK,
+         "about one cache lookup per sector read");
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  CHECK (remove (file_name), "remove \"%s\"", file_name);
+}
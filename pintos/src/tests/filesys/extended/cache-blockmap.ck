@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cache-blockmap) begin
+(cache-blockmap) create "big-file"
+(cache-blockmap) open "big-file"
+(cache-blockmap) write 400 sectors
+(cache-blockmap) close "big-file"
+(cache-blockmap) open "big-file"
+(cache-blockmap) read 400 sectors
+(cache-blockmap) about one cache lookup per sector read
+(cache-blockmap) close "big-file"
+(cache-blockmap) remove "big-file"
+(cache-blockmap) end
+EOF
+pass;
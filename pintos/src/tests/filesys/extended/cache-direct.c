@@ -0,0 +1,66 @@
+/* Caches a small hot file, then copies a large file through a
+   descriptor from open_direct().  The copy's whole sectors must
+   go around the buffer cache, so reading the hot file again
+   afterward is served entirely from the cache. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SECTOR_SIZE 512
+#define HOT_CNT 16
+#define BULK_CNT 128
+
+static char hot[HOT_CNT * SECTOR_SIZE];
+static char bulk[BULK_CNT * SECTOR_SIZE];
+static char buf[BULK_CNT * SECTOR_SIZE];
+
+void
+test_main (void)
+{
+  struct cache_stats before, after;
+  int hot_fd, bulk_fd, fd;
+
+  CHECK (create ("hot", sizeof hot), "create \"hot\"");
+  CHECK ((hot_fd = open ("hot")) > 1, "open \"hot\"");
+  random_bytes (hot, sizeof hot);
+  CHECK (write (hot_fd, hot, sizeof hot) == sizeof hot,
+         "write %d sectors to \"hot\"", HOT_CNT);
+
+  CHECK (create ("bulk", 0), "create \"bulk\"");
+  CHECK ((bulk_fd = open_direct ("bulk")) > 1, "open_direct \"bulk\"");
+  random_bytes (bulk, sizeof bulk);
+  cache_stats (&before);
+  CHECK (write (bulk_fd, bulk, sizeof bulk) == sizeof bulk,
+         "write %d sectors to \"bulk\"", BULK_CNT);
+  cache_stats (&after);
+  if (after.direct_writes - before.direct_writes != BULK_CNT)
+    fail ("%u sectors written around the cache, expected %d",
+          after.direct_writes - before.direct_writes, BULK_CNT);
+
+  msg ("read \"hot\" again");
+  seek (hot_fd, 0);
+  cache_stats (&before);
+  if (read (hot_fd, buf, sizeof hot) != sizeof hot)
+    fail ("read of \"hot\" failed");
+  cache_stats (&after);
+  compare_bytes (buf, hot, sizeof hot, 0, "hot");
+  if (after.misses != before.misses)
+    fail ("\"hot\" missed %u times after the direct copy",
+          after.misses - before.misses);
+
+  msg ("read \"bulk\" back through the cache");
+  CHECK ((fd = open ("bulk")) > 1, "open \"bulk\"");
+  if (read (fd, buf, sizeof bulk) != sizeof bulk)
+    fail ("read of \"bulk\" failed");
+  compare_bytes (buf, bulk, sizeof bulk, 0, "bulk");
+
+  msg ("close \"hot\"");
+  close (hot_fd);
+  msg ("close \"bulk\"");
+  close (bulk_fd);
+  close (fd);
+  CHECK (remove ("hot"), "remove \"hot\"");
+  CHECK (remove ("bulk"), "remove \"bulk\"");
+}
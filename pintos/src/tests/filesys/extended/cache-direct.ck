@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cache-direct) begin
+(cache-direct) create "hot"
+(cache-direct) open "hot"
+(cache-direct) write 16 sectors to "hot"
+(cache-direct) create "bulk"
+(cache-direct) open_direct "bulk"
+(cache-direct) write 128 sectors to "bulk"
+(cache-direct) read "hot" again
+(cache-direct) read "bulk" back through the cache
+(cache-direct) open "bulk"
+(cache-direct) close "hot"
+(cache-direct) close "bulk"
+(cache-direct) remove "hot"
+(cache-direct) remove "bulk"
+(cache-direct) end
+EOF
+pass;
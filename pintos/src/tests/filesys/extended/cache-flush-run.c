@@ -0,0 +1,56 @@
+/* Writes a run of sectors and waits for the write-behind flusher
+   to push them to disk.  The flusher writes dirty blocks back in
+   sector order and hands runs of consecutive sectors to the
+   device as single requests, so the data must take far fewer
+   requests than sectors. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SECTOR_SIZE 512
+#define SECTOR_CNT 32
+
+static char buf[SECTOR_CNT * SECTOR_SIZE];
+static char buf2[SECTOR_CNT * SECTOR_SIZE];
+
+void
+test_main (void)
+{
+  const char *file_name = "run-file";
+  struct cache_stats before, after;
+  unsigned sectors, requests;
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+
+  random_bytes (buf, sizeof buf);
+  cache_stats (&before);
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf,
+         "write %d sectors", SECTOR_CNT);
+
+  msg ("wait for the flusher");
+  do
+    cache_stats (&after);
+  while (after.flushes < before.flushes + SECTOR_CNT);
+
+  sectors = after.device_writes - before.device_writes;
+  requests = after.device_write_reqs - before.device_write_reqs;
+  if (sectors < SECTOR_CNT)
+    fail ("flusher reported %u flushes but only %u device writes",
+          after.flushes - before.flushes, sectors);
+  if (requests > SECTOR_CNT / 2)
+    fail ("%u sectors took %u write requests", sectors, requests);
+
+  msg ("read back \"%s\"", file_name);
+  seek (fd, 0);
+  if (read (fd, buf2, sizeof buf2) != sizeof buf2)
+    fail ("read of \"%s\" failed", file_name);
+  compare_bytes (buf2, buf, sizeof buf, 0, file_name);
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  CHECK (remove (file_name), "remove \"%s\"", file_name);
+}
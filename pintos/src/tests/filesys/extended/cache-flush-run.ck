@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cache-flush-run) begin
+(cache-flush-run) create "run-file"
+(cache-flush-run) open "run-file"
+(cache-flush-run) write 32 sectors
+(cache-flush-run) wait for the flusher
+(cache-flush-run) read back "run-file"
+(cache-flush-run) close "run-file"
+(cache-flush-run) remove "run-file"
+(cache-flush-run) end
+EOF
+pass;
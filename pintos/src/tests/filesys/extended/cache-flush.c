@@ -0,0 +1,51 @@
+/* Writes a few sectors and then waits, without closing the file,
+   for the write-behind flusher to push them to disk on its own.
+   Nothing the test does forces a write-back, so the flush counter
+   can only move because of the background thread. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SECTOR_SIZE 512
+#define SECTOR_CNT 8
+
+static char buf[SECTOR_CNT * SECTOR_SIZE];
+static char buf2[SECTOR_CNT * SECTOR_SIZE];
+
+void
+test_main (void)
+{
+  const char *file_name = "lazy-file";
+  struct cache_stats before, after;
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+
+  random_bytes (buf, sizeof buf);
+  cache_stats (&before);
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf,
+         "write %d sectors", SECTOR_CNT);
+
+  msg ("wait for the flusher");
+  do
+    cache_stats (&after);
+  while (after.flushes < before.flushes + SECTOR_CNT);
+
+  if (after.device_writes < before.device_writes + SECTOR_CNT)
+    fail ("flusher reported %u flushes but only %u device writes",
+          after.flushes - before.flushes,
+          after.device_writes - before.device_writes);
+
+  msg ("read back \"%s\"", file_name);
+  seek (fd, 0);
+  if (read (fd, buf2, sizeof buf2) != sizeof buf2)
+    fail ("read of \"%s\" failed", file_name);
+  compare_bytes (buf2, buf, sizeof buf, 0, file_name);
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  CHECK (remove (file_name), "remove \"%s\"", file_name);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cache-flush) begin
+(cache-flush) create "lazy-file"
+(cache-flush) open "lazy-file"
+(cache-flush) write 8 sectors
+(cache-flush) wait for the flusher
+(cache-flush) read back "lazy-file"
+(cache-flush) close "lazy-file"
+(cache-flush) remove "lazy-file"
+(cache-flush) end
+EOF
+pass;
@@ -0,0 +1,4 @@
+/* Hammers the same 32-sector working set as cache-lookup-sm
+   with a 1,024 block buffer cache. */
+
+#include "tests/filesys/extended/cache-lookup.inc"
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cache-lookup-lg) begin
+(cache-lookup-lg) create "hot-file"
+(cache-lookup-lg) open "hot-file"
+(cache-lookup-lg) read 32 sectors 100 times
+(cache-lookup-lg) hit rate should be at least 80%
+(cache-lookup-lg) index lookups take at most 8 comparisons each on average
+(cache-lookup-lg) close "hot-file"
+(cache-lookup-lg) remove "hot-file"
+(cache-lookup-lg) end
+EOF
+pass;
@@ -0,0 +1,4 @@
+/* Hammers a 32-sector working set with a 64 block buffer
+   cache. */
+
+#include "tests/filesys/extended/cache-lookup.inc"
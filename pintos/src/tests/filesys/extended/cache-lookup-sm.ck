@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cache-lookup-sm) begin
+(cache-lookup-sm) create "hot-file"
+(cache-lookup-sm) open "hot-file"
+(cache-lookup-sm) read 32 sectors 100 times
+(cache-lookup-sm) hit rate should be at least 80%
+(cache-lookup-sm) index lookups take at most 8 comparisons each on average
+(cache-lookup-sm) close "hot-file"
+(cache-lookup-sm) remove "hot-file"
+(cache-lookup-sm) end
+EOF
+pass;
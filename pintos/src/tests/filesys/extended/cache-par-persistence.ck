@@ -0,0 +1,6 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_archive ({"child-cache-par" => "tests/filesys/extended/child-cache-par"});
+pass;
@@ -0,0 +1,45 @@
+/* Spawns several children that each stream through a file of
+   their own at the same time.  Together the files are larger
+   than the buffer cache, so some children keep missing while
+   the others hit; every child must still read back exactly what
+   was written. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/filesys/extended/cache-par.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[FILE_SIZE];
+
+void
+test_main (void)
+{
+  pid_t children[CHILD_CNT];
+  char file_name[16];
+  int fd;
+  int i;
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      snprintf (file_name, sizeof file_name, "par-file-%d", i);
+      CHECK (create (file_name, 0), "create \"%s\"", file_name);
+      CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+      random_init (i);
+      random_bytes (buf, sizeof buf);
+      CHECK (write (fd, buf, sizeof buf) == FILE_SIZE,
+             "write \"%s\"", file_name);
+      msg ("close \"%s\"", file_name);
+      close (fd);
+    }
+
+  exec_children ("child-cache-par", children, CHILD_CNT);
+  wait_children (children, CHILD_CNT);
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      snprintf (file_name, sizeof file_name, "par-file-%d", i);
+      CHECK (remove (file_name), "remove \"%s\"", file_name);
+    }
+}
@@ -0,0 +1,37 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cache-par) begin
+(cache-par) create "par-file-0"
+(cache-par) open "par-file-0"
+(cache-par) write "par-file-0"
+(cache-par) close "par-file-0"
+(cache-par) create "par-file-1"
+(cache-par) open "par-file-1"
+(cache-par) write "par-file-1"
+(cache-par) close "par-file-1"
+(cache-par) create "par-file-2"
+(cache-par) open "par-file-2"
+(cache-par) write "par-file-2"
+(cache-par) close "par-file-2"
+(cache-par) create "par-file-3"
+(cache-par) open "par-file-3"
+(cache-par) write "par-file-3"
+(cache-par) close "par-file-3"
+(cache-par) exec child 1 of 4: "child-cache-par 0"
+(cache-par) exec child 2 of 4: "child-cache-par 1"
+(cache-par) exec child 3 of 4: "child-cache-par 2"
+(cache-par) exec child 4 of 4: "child-cache-par 3"
+(cache-par) wait for child 1 of 4 returned 0 (expected 0)
+(cache-par) wait for child 2 of 4 returned 1 (expected 1)
+(cache-par) wait for child 3 of 4 returned 2 (expected 2)
+(cache-par) wait for child 4 of 4 returned 3 (expected 3)
+(cache-par) remove "par-file-0"
+(cache-par) remove "par-file-1"
+(cache-par) remove "par-file-2"
+(cache-par) remove "par-file-3"
+(cache-par) end
+EOF
+pass;
@@ -0,0 +1,8 @@
+#ifndef TESTS_FILESYS_EXTENDED_CACHE_PAR_H
+#define TESTS_FILESYS_EXTENDED_CACHE_PAR_H
+
+#define CHILD_CNT 4
+#define FILE_SIZE (40 * 512)
+#define PASS_CNT 4
+
+#endif /* tests/filesys/extended/cache-par.h */
@@ -0,0 +1,57 @@
+/* Reads a file that is not in the buffer cache one sector at a
+   time.  Without read-ahead every one of those reads misses; with
+   it the read-ahead thread stays in front of the reader, so most
+   of them have to hit.  The kernel runs with a 32 block cache
+   (see Make.tests) so that writing the file pushes its first
+   sectors out again before they are read. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SECTOR_SIZE 512
+#define SECTOR_CNT 100
+
+static char buf[SECTOR_CNT * SECTOR_SIZE];
+static char sector[SECTOR_SIZE];
+
+void
+test_main (void)
+{
+  const char *file_name = "seq-file";
+  struct cache_stats before, after;
+  unsigned hits, misses;
+  int fd, i;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  random_bytes (buf, sizeof buf);
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf,
+         "write %d sectors", SECTOR_CNT);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  cache_stats (&before);
+  msg ("read \"%s\" one sector at a time", file_name);
+  for (i = 0; i < SECTOR_CNT; i++)
+    {
+      if (read (fd, sector, SECTOR_SIZE) != SECTOR_SIZE)
+        fail ("read of sector %d failed", i);
+      compare_bytes (sector, buf + i * SECTOR_SIZE, SECTOR_SIZE,
+                     i * SECTOR_SIZE, file_name);
+    }
+  cache_stats (&after);
+
+  hits = after.hits - before.hits;
+  misses = after.misses - before.misses;
+  CHECK (after.readaheads > before.readaheads,
+         "read-ahead brought sectors in");
+  CHECK (100 * hits >= 80 * (hits + misses),
+         "hit rate should be at least 80%%");
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  CHECK (remove (file_name), "remove \"%s\"", file_name);
+}
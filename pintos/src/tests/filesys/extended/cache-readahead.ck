@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cache-readahead) begin
+(cache-readahead) create "seq-file"
+(cache-readahead) open "seq-file"
+(cache-readahead) write 100 sectors
+(cache-readahead) close "seq-file"
+(cache-readahead) open "seq-file"
+(cache-readahead) read "seq-file" one sector at a time
+(cache-readahead) read-ahead brought sectors in
+(cache-readahead) hit rate should be at least 80%
+(cache-readahead) close "seq-file"
+(cache-readahead) remove "seq-file"
+(cache-readahead) end
+EOF
+pass;
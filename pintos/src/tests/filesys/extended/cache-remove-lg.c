@@ -0,0 +1,57 @@
+/* Writes a 2 MB file and removes it, several times over, on a
+   disk with room for only one such file at a time (see
+   Make.tests).  Removing the file hands its sectors to the
+   reclaimer, which reads each of its pointer blocks once,
+   batched.  The next write must get every sector back, freeing
+   them itself if the reclaimer has not got to them yet. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (2 * 1024 * 1024)
+#define CHUNK_SIZE (64 * 1024)
+#define LOOP_CNT 3
+
+/* Pointer blocks of a FILE_SIZE file: the indirect block, the
+   doubly indirect block and its leaves. */
+#define INDEX_CNT (1 + 1 + (FILE_SIZE / 512 - 112 - 128 + 127) / 128)
+
+/* Lookups allowed for the directory entry and the inode itself. */
+#define SLACK 16
+
+static char buf[CHUNK_SIZE];
+
+void
+test_main (void)
+{
+  const char *file_name = "big";
+  struct cache_stats before, after;
+  int loop;
+
+  for (loop = 0; loop < LOOP_CNT; loop++)
+    {
+      unsigned lookups;
+      int fd, ofs;
+
+      if (!create (file_name, 0))
+        fail ("create \"%s\" failed", file_name);
+      if ((fd = open (file_name)) < 2)
+        fail ("open \"%s\" failed", file_name);
+      for (ofs = 0; ofs < FILE_SIZE; ofs += CHUNK_SIZE)
+        if (write (fd, buf, sizeof buf) != sizeof buf)
+          fail ("write at offset %d failed", ofs);
+      close (fd);
+
+      cache_stats (&before);
+      if (!remove (file_name))
+        fail ("remove \"%s\" failed", file_name);
+      cache_stats (&after);
+
+      lookups = (after.hits - before.hits) + (after.misses - before.misses);
+      if (lookups > INDEX_CNT + SLACK)
+        fail ("remove %d took %u cache lookups", loop, lookups);
+    }
+  msg ("wrote and removed %d MB %d times", FILE_SIZE / (1024 * 1024),
+       LOOP_CNT);
+}
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cache-remove-lg) begin
+(cache-remove-lg) wrote and removed 2 MB 3 times
+(cache-remove-lg) end
+EOF
+pass;
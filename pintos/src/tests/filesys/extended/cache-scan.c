@@ -0,0 +1,111 @@
+/* Under the 2Q replacement policy, repeatedly scans a file much
+   larger than the buffer cache, each time followed by opening a
+   set of small files.  The small files' data lives in their
+   inodes, which are metadata, so the scans must not push them
+   out: by the last round, opening them again should hardly ever
+   miss. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SECTOR_SIZE 512
+#define SMALL_CNT 20
+#define SMALL_SIZE 300
+#define BIG_CNT 200
+#define ROUNDS 3
+
+static char small[SMALL_CNT][SMALL_SIZE];
+static char big[BIG_CNT * SECTOR_SIZE];
+static char buf[SECTOR_SIZE];
+
+/* Reads "big" one sector at a time. */
+static void
+scan (void)
+{
+  int fd, i;
+
+  CHECK ((fd = open ("big")) > 1, "open \"big\"");
+  for (i = 0; i < BIG_CNT; i++)
+    {
+      if (read (fd, buf, SECTOR_SIZE) != SECTOR_SIZE)
+        fail ("read of sector %d of \"big\" failed", i);
+      compare_bytes (buf, big + i * SECTOR_SIZE, SECTOR_SIZE,
+                     i * SECTOR_SIZE, "big");
+    }
+  close (fd);
+}
+
+/* Opens and reads back each small file, and returns the number
+   of cache misses that took. */
+static unsigned
+read_small (void)
+{
+  struct cache_stats before, after;
+  char name[32];
+  int fd, i;
+
+  cache_stats (&before);
+  for (i = 0; i < SMALL_CNT; i++)
+    {
+      snprintf (name, sizeof name, "small/%d", i);
+      if ((fd = open (name)) < 2)
+        fail ("open \"%s\" failed", name);
+      if (read (fd, buf, SMALL_SIZE) != SMALL_SIZE)
+        fail ("read of \"%s\" failed", name);
+      compare_bytes (buf, small[i], SMALL_SIZE, 0, name);
+      close (fd);
+    }
+  cache_stats (&after);
+  return after.misses - before.misses;
+}
+
+void
+test_main (void)
+{
+  char name[32];
+  unsigned misses = 0;
+  int fd, i;
+
+  CHECK (mkdir ("small"), "mkdir \"small\"");
+  msg ("create %d small files", SMALL_CNT);
+  for (i = 0; i < SMALL_CNT; i++)
+    {
+      snprintf (name, sizeof name, "small/%d", i);
+      random_bytes (small[i], SMALL_SIZE);
+      if (!create (name, 0) || (fd = open (name)) < 2)
+        fail ("create \"%s\" failed", name);
+      if (write (fd, small[i], SMALL_SIZE) != SMALL_SIZE)
+        fail ("write to \"%s\" failed", name);
+      close (fd);
+    }
+
+  CHECK (create ("big", 0), "create \"big\"");
+  CHECK ((fd = open ("big")) > 1, "open \"big\"");
+  random_bytes (big, sizeof big);
+  CHECK (write (fd, big, sizeof big) == sizeof big,
+         "write %d sectors to \"big\"", BIG_CNT);
+  close (fd);
+
+  for (i = 0; i < ROUNDS; i++)
+    {
+      msg ("round %d", i);
+      scan ();
+      misses = read_small ();
+    }
+  if (misses > SMALL_CNT / 4)
+    fail ("reopening %d small files after a scan missed %u times",
+          SMALL_CNT, misses);
+
+  msg ("remove files");
+  for (i = 0; i < SMALL_CNT; i++)
+    {
+      snprintf (name, sizeof name, "small/%d", i);
+      if (!remove (name))
+        fail ("remove \"%s\" failed", name);
+    }
+  CHECK (remove ("small"), "remove \"small\"");
+  CHECK (remove ("big"), "remove \"big\"");
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cache-scan) begin
+(cache-scan) mkdir "small"
+(cache-scan) create 20 small files
+(cache-scan) create "big"
+(cache-scan) open "big"
+(cache-scan) write 200 sectors to "big"
+(cache-scan) round 0
+(cache-scan) open "big"
+(cache-scan) round 1
+(cache-scan) open "big"
+(cache-scan) round 2
+(cache-scan) open "big"
+(cache-scan) remove files
+(cache-scan) remove "small"
+(cache-scan) remove "big"
+(cache-scan) end
+EOF
+pass;
@@ -0,0 +1,45 @@
+/* Child process for cache-par.
+   Reads the file our parent wrote for us from start to end
+   PASS_CNT times, checking its contents on every pass. */
+
+#include <random.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/filesys/extended/cache-par.h"
+#include "tests/lib.h"
+
+const char *test_name = "child-cache-par";
+
+static char expected[FILE_SIZE];
+static char actual[FILE_SIZE];
+
+int
+main (int argc, const char *argv[])
+{
+  char file_name[16];
+  int child_idx;
+  int fd;
+  int pass;
+
+  quiet = true;
+
+  CHECK (argc == 2, "argc must be 2, actually %d", argc);
+  child_idx = atoi (argv[1]);
+  snprintf (file_name, sizeof file_name, "par-file-%d", child_idx);
+
+  random_init (child_idx);
+  random_bytes (expected, sizeof expected);
+
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  for (pass = 0; pass < PASS_CNT; pass++)
+    {
+      seek (fd, 0);
+      CHECK (read (fd, actual, sizeof actual) == FILE_SIZE,
+             "read \"%s\" on pass %d", file_name, pass);
+      compare_bytes (actual, expected, sizeof actual, 0, file_name);
+    }
+  close (fd);
+
+  return child_idx;
+}
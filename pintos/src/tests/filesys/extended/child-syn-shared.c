@@ -0,0 +1,55 @@
+/* Child process for syn-shared.
+   Rewrites our stripe of the shared file PASS_CNT times, then
+   reads the whole file back and checks our stripe and the
+   file's length after every pass. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/filesys/extended/syn-shared.h"
+#include "tests/lib.h"
+
+const char *test_name = "child-syn-shared";
+
+static char stripe[STRIPE_SIZE];
+static char actual[FILE_SIZE];
+
+int
+main (int argc, const char *argv[])
+{
+  int child_idx;
+  int fd;
+  int pass;
+
+  quiet = true;
+
+  CHECK (argc == 2, "argc must be 2, actually %d", argc);
+  child_idx = atoi (argv[1]);
+
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  for (pass = 0; pass < PASS_CNT; pass++)
+    {
+      size_t ofs;
+
+      memset (stripe, stripe_byte (child_idx, pass), sizeof stripe);
+      seek (fd, child_idx * STRIPE_SIZE);
+      for (ofs = 0; ofs < sizeof stripe; ofs += CHUNK_SIZE)
+        {
+          size_t size = sizeof stripe - ofs;
+          if (size > CHUNK_SIZE)
+            size = CHUNK_SIZE;
+          CHECK (write (fd, stripe + ofs, size) == (int) size,
+                 "write \"%s\" on pass %d", file_name, pass);
+        }
+
+      seek (fd, 0);
+      CHECK (read (fd, actual, sizeof actual) == FILE_SIZE,
+             "read \"%s\" on pass %d", file_name, pass);
+      compare_bytes (actual + child_idx * STRIPE_SIZE, stripe, sizeof stripe,
+                     child_idx * STRIPE_SIZE, file_name);
+    }
+  close (fd);
+
+  return child_idx;
+}
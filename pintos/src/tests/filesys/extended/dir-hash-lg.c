@@ -0,0 +1,82 @@
+/* Creates 5,000 files in one directory, lists it, and removes
+   them all.  A directory that large is kept hashed, so adding a
+   name should cost about the same number of cache lookups when
+   the directory is nearly full as when it is nearly empty,
+   instead of one lookup per entry already there. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 5000
+
+/* Creates timed at each end of the run. */
+#define SAMPLE_CNT 100
+
+/* Extra lookups allowed per create for names that share a
+   bucket. */
+#define SLACK 10
+
+/* Creates files FIRST through LAST - 1 and returns the cache
+   lookups they took. */
+static unsigned
+create_range (int first, int last)
+{
+  struct cache_stats before, after;
+  char file_name[16];
+  int i;
+
+  cache_stats (&before);
+  for (i = first; i < last; i++)
+    {
+      snprintf (file_name, sizeof file_name, "f%d", i);
+      if (!create (file_name, 0))
+        fail ("create \"%s\" failed", file_name);
+    }
+  cache_stats (&after);
+  return (after.hits - before.hits) + (after.misses - before.misses);
+}
+
+void
+test_main (void)
+{
+  char name[READDIR_MAX_LEN + 1];
+  char file_name[16];
+  unsigned early, late;
+  int fd, cnt, i;
+
+  CHECK (mkdir ("/d"), "mkdir \"/d\"");
+  CHECK (chdir ("/d"), "chdir \"/d\"");
+
+  msg ("create %d files", FILE_CNT);
+  create_range (0, SAMPLE_CNT);
+  early = create_range (SAMPLE_CNT, 2 * SAMPLE_CNT);
+  create_range (2 * SAMPLE_CNT, FILE_CNT - SAMPLE_CNT);
+  late = create_range (FILE_CNT - SAMPLE_CNT, FILE_CNT);
+  if (late > early + SLACK * SAMPLE_CNT)
+    fail ("last %d creates took %u lookups, first took %u",
+          SAMPLE_CNT, late, early);
+  msg ("late creates cost about as much as early ones");
+
+  CHECK ((fd = open ("/d")) > 1, "open \"/d\"");
+  cnt = 0;
+  while (readdir (fd, name))
+    cnt++;
+  close (fd);
+  if (cnt != FILE_CNT)
+    fail ("readdir returned %d names, expected %d", cnt, FILE_CNT);
+  msg ("readdir returned %d names", FILE_CNT);
+
+  msg ("remove %d files", FILE_CNT);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (file_name, sizeof file_name, "f%d", i);
+      if (!remove (file_name))
+        fail ("remove \"%s\" failed", file_name);
+    }
+
+  CHECK (chdir ("/"), "chdir \"/\"");
+  CHECK (remove ("/d"), "rmdir \"/d\"");
+}
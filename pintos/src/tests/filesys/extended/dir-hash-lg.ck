@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dir-hash-lg) begin
+(dir-hash-lg) mkdir "/d"
+(dir-hash-lg) chdir "/d"
+(dir-hash-lg) create 5000 files
+(dir-hash-lg) late creates cost about as much as early ones
+(dir-hash-lg) open "/d"
+(dir-hash-lg) readdir returned 5000 names
+(dir-hash-lg) remove 5000 files
+(dir-hash-lg) chdir "/"
+(dir-hash-lg) rmdir "/d"
+(dir-hash-lg) end
+EOF
+pass;
@@ -0,0 +1,84 @@
+/* Opens a file at the bottom of a deep chain of directories,
+   and a name missing from it, over and over.  Once each
+   directory along the path has been looked up, the directory
+   entry cache should resolve the path again without reading
+   any directory, leaving only the file's own inode to read. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define DEPTH 16
+#define LOOP_CNT 50
+
+/* Lookups allowed per open for the file's own inode. */
+#define SLACK 4
+
+static char path[DEPTH * 4 + 16];
+static char missing[sizeof path + 16];
+
+/* Opens NAME LOOP_CNT times, which must succeed if EXPECT_OK,
+   and returns the cache lookups that took. */
+static unsigned
+open_loop (const char *name, bool expect_ok)
+{
+  struct cache_stats before, after;
+  int i;
+
+  cache_stats (&before);
+  for (i = 0; i < LOOP_CNT; i++)
+    {
+      int fd = open (name);
+      if ((fd > 1) != expect_ok)
+        fail ("open \"%s\" returned %d", name, fd);
+      if (fd > 1)
+        close (fd);
+    }
+  cache_stats (&after);
+  return (after.hits - before.hits) + (after.misses - before.misses);
+}
+
+void
+test_main (void)
+{
+  unsigned lookups;
+  size_t len;
+  int i;
+
+  msg ("make %d nested directories", DEPTH);
+  for (i = 0; i < DEPTH; i++)
+    {
+      len = strlen (path);
+      snprintf (path + len, sizeof path - len, "/d%d", i);
+      if (!mkdir (path))
+        fail ("mkdir \"%s\" failed", path);
+    }
+  len = strlen (path);
+  snprintf (path + len, sizeof path - len, "/f");
+  CHECK (create (path, 0), "create file at depth %d", DEPTH);
+  snprintf (missing, sizeof missing, "%s-missing", path);
+
+  msg ("open it %d times", LOOP_CNT);
+  open_loop (path, true);
+  lookups = open_loop (path, true);
+  if (lookups > LOOP_CNT * SLACK)
+    fail ("%u lookups for %d opens", lookups, LOOP_CNT);
+  msg ("opens did not read the directories");
+
+  msg ("open a missing name %d times", LOOP_CNT);
+  open_loop (missing, false);
+  lookups = open_loop (missing, false);
+  if (lookups != 0)
+    fail ("%u lookups for %d failed opens", lookups, LOOP_CNT);
+  msg ("failed opens did not read the directories");
+
+  msg ("remove the tree");
+  for (i = DEPTH; i >= 0; i--)
+    {
+      if (!remove (path))
+        fail ("remove \"%s\" failed", path);
+      *strrchr (path, '/') = '\0';
+    }
+}
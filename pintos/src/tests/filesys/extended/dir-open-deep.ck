@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dir-open-deep) begin
+(dir-open-deep) make 16 nested directories
+(dir-open-deep) create file at depth 16
+(dir-open-deep) open it 50 times
+(dir-open-deep) opens did not read the directories
+(dir-open-deep) open a missing name 50 times
+(dir-open-deep) failed opens did not read the directories
+(dir-open-deep) remove the tree
+(dir-open-deep) end
+EOF
+pass;
@@ -0,0 +1,44 @@
+/* Creates a large file and grows another one by a large amount
+   in a single write.  Each takes all of its sectors from the
+   free map in a batch, so the free map file is written a handful
+   of times rather than once per sector. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SECTOR_SIZE 512
+#define BIG_CNT 300
+#define GROW_CNT 200
+
+static char buf[GROW_CNT * SECTOR_SIZE];
+
+void
+test_main (void)
+{
+  struct cache_stats before, after;
+  int fd;
+
+  cache_stats (&before);
+  CHECK (create ("big", BIG_CNT * SECTOR_SIZE),
+         "create \"big\" with %d sectors", BIG_CNT);
+  cache_stats (&after);
+  if (after.free_map_writes - before.free_map_writes > 4)
+    fail ("creating \"big\" wrote the free map %u times",
+          after.free_map_writes - before.free_map_writes);
+
+  CHECK (create ("grow", 0), "create \"grow\"");
+  CHECK ((fd = open ("grow")) > 1, "open \"grow\"");
+  cache_stats (&before);
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf,
+         "write %d sectors to \"grow\"", GROW_CNT);
+  cache_stats (&after);
+  if (after.free_map_writes - before.free_map_writes > 2)
+    fail ("growing \"grow\" wrote the free map %u times",
+          after.free_map_writes - before.free_map_writes);
+
+  msg ("close \"grow\"");
+  close (fd);
+  CHECK (remove ("big"), "remove \"big\"");
+  CHECK (remove ("grow"), "remove \"grow\"");
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(free-map-batch) begin
+(free-map-batch) create "big" with 300 sectors
+(free-map-batch) create "grow"
+(free-map-batch) open "grow"
+(free-map-batch) write 200 sectors to "grow"
+(free-map-batch) close "grow"
+(free-map-batch) remove "big"
+(free-map-batch) remove "grow"
+(free-map-batch) end
+EOF
+pass;
@@ -0,0 +1,50 @@
+/* Fills most of the disk with one large file, then creates small
+   files in the space that is left.  The free map's per-group
+   free counts let each allocation skip the full part of the disk
+   instead of scanning it bit by bit, so no allocation should
+   look at more than one block group's worth of bits (512). */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILLER_CNT 3500
+#define FILE_CNT 20
+
+void
+test_main (void)
+{
+  struct cache_stats before, after;
+  unsigned allocs, scanned;
+  char name[16];
+  int i;
+
+  CHECK (create ("filler", FILLER_CNT * 512),
+         "create \"filler\" with %d sectors", FILLER_CNT);
+
+  cache_stats (&before);
+  msg ("create %d small files", FILE_CNT);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      if (!create (name, 512))
+        fail ("create \"%s\" failed", name);
+    }
+  cache_stats (&after);
+
+  allocs = after.free_map_allocs - before.free_map_allocs;
+  scanned = after.free_map_scanned - before.free_map_scanned;
+  CHECK (allocs >= FILE_CNT, "at least %d allocations", FILE_CNT);
+  if (scanned > allocs * 512)
+    fail ("%u allocations examined %u free map bits", allocs, scanned);
+
+  msg ("remove files");
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      if (!remove (name))
+        fail ("remove \"%s\" failed", name);
+    }
+  CHECK (remove ("filler"), "remove \"filler\"");
+}
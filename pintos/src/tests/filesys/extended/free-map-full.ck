@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(free-map-full) begin
+(free-map-full) create "filler" with 3500 sectors
+(free-map-full) create 20 small files
+(free-map-full) at least 20 allocations
+(free-map-full) remove files
+(free-map-full) remove "filler"
+(free-map-full) end
+EOF
+pass;
@@ -0,0 +1,42 @@
+/* Creates and removes many small files on a 16 MB disk, whose
+   free map file is 8 sectors long.  Every allocation and release
+   here lands in the first of those sectors, so that should be
+   the only one rewritten each time, not the whole free map. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 40
+
+void
+test_main (void)
+{
+  struct cache_stats before, after;
+  unsigned writes, sectors;
+  char name[16];
+  int i;
+
+  cache_stats (&before);
+  msg ("create and remove %d files", FILE_CNT);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      if (!create (name, 512))
+        fail ("create \"%s\" failed", name);
+    }
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      if (!remove (name))
+        fail ("remove \"%s\" failed", name);
+    }
+  cache_stats (&after);
+
+  writes = after.free_map_writes - before.free_map_writes;
+  sectors = after.free_map_sectors - before.free_map_sectors;
+  CHECK (writes > 0, "free map was written");
+  if (sectors > 2 * writes)
+    fail ("%u free map writes rewrote %u sectors", writes, sectors);
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(free-map-small) begin
+(free-map-small) create and remove 40 files
+(free-map-small) free map was written
+(free-map-small) end
+EOF
+pass;
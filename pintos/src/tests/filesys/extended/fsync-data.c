@@ -0,0 +1,94 @@
+/* Writes two files and syncs them one at a time.  fsync() must
+   write back only the blocks of the file it is given, every one
+   of them that the flusher has not already written, and leave
+   nothing behind for a second call.  fdatasync() on the other
+   file must do the same. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SECTOR_SIZE 512
+#define SECTOR_CNT 16
+
+static char buf_a[SECTOR_CNT * SECTOR_SIZE];
+static char buf_b[SECTOR_CNT * SECTOR_SIZE];
+static char buf[SECTOR_CNT * SECTOR_SIZE];
+
+/* Syncs FD with fsync() if DATA_ONLY is false, fdatasync() if it
+   is true, and checks that the blocks it wrote, together with
+   those the flusher wrote since BEFORE, cover all of FD's
+   SECTOR_CNT sectors and no more.  Then checks that syncing again
+   writes nothing. */
+static void
+sync_file (const char *name, int fd, bool data_only,
+           const struct cache_stats *before)
+{
+  const char *call = data_only ? "fdatasync" : "fsync";
+  struct cache_stats mid, after;
+  long long writes;
+  unsigned synced;
+
+  cache_stats (&mid);
+  writes = cache_write_cnt ();
+  CHECK ((data_only ? fdatasync (fd) : fsync (fd)) == 0,
+         "%s \"%s\"", call, name);
+  writes = cache_write_cnt () - writes;
+  cache_stats (&after);
+
+  synced = after.sync_writes - mid.sync_writes;
+  if (synced > SECTOR_CNT)
+    fail ("%s wrote %u blocks for a file of %d", call, synced, SECTOR_CNT);
+  if (synced + (after.flushes - before->flushes) < SECTOR_CNT)
+    fail ("%s wrote %u blocks, the flusher %u, of %d dirty", call,
+          synced, after.flushes - before->flushes, SECTOR_CNT);
+  if (writes < synced)
+    fail ("%s wrote %u blocks in %lld device writes", call, synced, writes);
+
+  cache_stats (&mid);
+  CHECK ((data_only ? fdatasync (fd) : fsync (fd)) == 0,
+         "%s \"%s\" again", call, name);
+  cache_stats (&after);
+  if (after.sync_writes != mid.sync_writes)
+    fail ("second %s wrote %u blocks", call,
+          after.sync_writes - mid.sync_writes);
+}
+
+void
+test_main (void)
+{
+  struct cache_stats before;
+  int fd_a, fd_b;
+
+  CHECK (create ("a", 0), "create \"a\"");
+  CHECK (create ("b", 0), "create \"b\"");
+  CHECK ((fd_a = open ("a")) > 1, "open \"a\"");
+  CHECK ((fd_b = open ("b")) > 1, "open \"b\"");
+  random_bytes (buf_a, sizeof buf_a);
+  random_bytes (buf_b, sizeof buf_b);
+
+  cache_stats (&before);
+  CHECK (write (fd_a, buf_a, sizeof buf_a) == sizeof buf_a,
+         "write %d sectors to \"a\"", SECTOR_CNT);
+  CHECK (write (fd_b, buf_b, sizeof buf_b) == sizeof buf_b,
+         "write %d sectors to \"b\"", SECTOR_CNT);
+  sync_file ("a", fd_a, false, &before);
+  sync_file ("b", fd_b, true, &before);
+
+  msg ("read back \"a\" and \"b\"");
+  seek (fd_a, 0);
+  if (read (fd_a, buf, sizeof buf) != sizeof buf)
+    fail ("read of \"a\" failed");
+  compare_bytes (buf, buf_a, sizeof buf, 0, "a");
+  seek (fd_b, 0);
+  if (read (fd_b, buf, sizeof buf) != sizeof buf)
+    fail ("read of \"b\" failed");
+  compare_bytes (buf, buf_b, sizeof buf, 0, "b");
+
+  CHECK (fsync (fd_a + fd_b + 100) == -1, "fsync of a bad fd fails");
+  msg ("close \"a\"");
+  close (fd_a);
+  msg ("close \"b\"");
+  close (fd_b);
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fsync-data) begin
+(fsync-data) create "a"
+(fsync-data) create "b"
+(fsync-data) open "a"
+(fsync-data) open "b"
+(fsync-data) write 16 sectors to "a"
+(fsync-data) write 16 sectors to "b"
+(fsync-data) fsync "a"
+(fsync-data) fsync "a" again
+(fsync-data) fdatasync "b"
+(fsync-data) fdatasync "b" again
+(fsync-data) read back "a" and "b"
+(fsync-data) fsync of a bad fd fails
+(fsync-data) close "a"
+(fsync-data) close "b"
+(fsync-data) end
+EOF
+pass;
@@ -0,0 +1,7 @@
+/* Creates a directory,
+   then creates 50 files in that directory,
+   on a kernel that gives new files extents. */
+
+#define FILE_CNT 50
+#define DIRECTORY "/x"
+#include "tests/filesys/extended/grow-dir.inc"
@@ -0,0 +1,59 @@
+/* Grows a file to 64 MB, far past what the direct, indirect and
+   doubly indirect pointers reach, a chunk at a time, then reads
+   it all back.  Every word holds its own offset, so a chunk that
+   lands in the wrong place is caught. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (64 * 1024 * 1024)
+#define CHUNK_SIZE (64 * 1024)
+
+static int buf[CHUNK_SIZE / sizeof (int)];
+
+/* Fills BUF with the offsets of its words, for a chunk at OFS. */
+static void
+fill (int ofs)
+{
+  size_t i;
+
+  for (i = 0; i < sizeof buf / sizeof *buf; i++)
+    buf[i] = ofs + i * sizeof *buf;
+}
+
+void
+test_main (void)
+{
+  const char *file_name = "huge";
+  int fd;
+  int ofs;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  msg ("write %d MB to \"%s\"", FILE_SIZE / (1024 * 1024), file_name);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += CHUNK_SIZE)
+    {
+      fill (ofs);
+      if (write (fd, buf, sizeof buf) != sizeof buf)
+        fail ("write %d bytes at offset %d failed", CHUNK_SIZE, ofs);
+    }
+  CHECK (filesize (fd) == FILE_SIZE, "check size of \"%s\"", file_name);
+
+  msg ("read back \"%s\"", file_name);
+  seek (fd, 0);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += CHUNK_SIZE)
+    {
+      size_t i;
+
+      if (read (fd, buf, sizeof buf) != sizeof buf)
+        fail ("read %d bytes at offset %d failed", CHUNK_SIZE, ofs);
+      for (i = 0; i < sizeof buf / sizeof *buf; i++)
+        if (buf[i] != (int) (ofs + i * sizeof *buf))
+          fail ("byte offset %d holds %d", (int) (ofs + i * sizeof *buf),
+                buf[i]);
+    }
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  CHECK (remove (file_name), "remove \"%s\"", file_name);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-huge) begin
+(grow-huge) create "huge"
+(grow-huge) open "huge"
+(grow-huge) write 64 MB to "huge"
+(grow-huge) check size of "huge"
+(grow-huge) read back "huge"
+(grow-huge) close "huge"
+(grow-huge) remove "huge"
+(grow-huge) end
+EOF
+pass;
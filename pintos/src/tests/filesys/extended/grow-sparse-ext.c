@@ -0,0 +1,39 @@
+/* Tests that seeking past the end of a file and writing will
+   zero out the region in between on a kernel that gives new
+   files extents, even when the sectors were last used by a
+   file that has been removed. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[76543];
+
+void
+test_main (void)
+{
+  const char *junk_name = "junk";
+  const char *file_name = "testfile";
+  char zero = 0;
+  int fd;
+
+  CHECK (create (junk_name, 0), "create \"%s\"", junk_name);
+  CHECK ((fd = open (junk_name)) > 1, "open \"%s\"", junk_name);
+  memset (buf, 0xa5, sizeof buf);
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf,
+         "write \"%s\"", junk_name);
+  msg ("close \"%s\"", junk_name);
+  close (fd);
+  CHECK (remove (junk_name), "remove \"%s\"", junk_name);
+  memset (buf, 0, sizeof buf);
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  msg ("seek \"%s\"", file_name);
+  seek (fd, sizeof buf - 1);
+  CHECK (write (fd, &zero, 1) > 0, "write \"%s\"", file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, sizeof buf);
+}
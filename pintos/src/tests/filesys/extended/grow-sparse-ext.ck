@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-sparse-ext) begin
+(grow-sparse-ext) create "junk"
+(grow-sparse-ext) open "junk"
+(grow-sparse-ext) write "junk"
+(grow-sparse-ext) close "junk"
+(grow-sparse-ext) remove "junk"
+(grow-sparse-ext) create "testfile"
+(grow-sparse-ext) open "testfile"
+(grow-sparse-ext) seek "testfile"
+(grow-sparse-ext) write "testfile"
+(grow-sparse-ext) close "testfile"
+(grow-sparse-ext) open "testfile" for verification
+(grow-sparse-ext) verified contents of "testfile"
+(grow-sparse-ext) close "testfile"
+(grow-sparse-ext) end
+EOF
+pass;
@@ -0,0 +1,60 @@
+/* Creates a large file and writes one byte far into another,
+   then checks that only the sectors written were allocated and
+   that the rest of both files reads back as zeros. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SECTOR_SIZE 512
+
+/* Past the direct and singly indirect pointers. */
+#define FILE_SIZE (300 * SECTOR_SIZE)
+
+static char buf[FILE_SIZE];
+static char zeros[FILE_SIZE];
+
+void
+test_main (void)
+{
+  struct cache_stats before, after;
+  char byte = 'x';
+  int fd;
+
+  cache_stats (&before);
+  CHECK (create ("big", FILE_SIZE), "create \"big\"");
+  cache_stats (&after);
+  /* Its inode, and perhaps a new directory sector. */
+  CHECK (before.free_sectors - after.free_sectors <= 2,
+         "creating \"big\" allocated no data sectors");
+
+  CHECK ((fd = open ("big")) > 1, "open \"big\"");
+  CHECK (filesize (fd) == FILE_SIZE, "check size of \"big\"");
+  CHECK (read (fd, buf, sizeof buf) == FILE_SIZE, "read \"big\"");
+  compare_bytes (buf, zeros, sizeof buf, 0, "big");
+  msg ("close \"big\"");
+  close (fd);
+
+  CHECK (create ("holey", 0), "create \"holey\"");
+  CHECK ((fd = open ("holey")) > 1, "open \"holey\"");
+  msg ("seek \"holey\"");
+  seek (fd, FILE_SIZE - 1);
+  cache_stats (&before);
+  CHECK (write (fd, &byte, 1) == 1, "write \"holey\"");
+  cache_stats (&after);
+
+  /* The data sector, the doubly indirect block and one of its
+     leaves. */
+  CHECK (before.free_sectors - after.free_sectors <= 3,
+         "write allocated only the sector written and its map");
+  msg ("close \"holey\"");
+  close (fd);
+
+  memset (buf, 0, sizeof buf);
+  buf[FILE_SIZE - 1] = byte;
+  check_file ("holey", buf, sizeof buf);
+
+  CHECK (remove ("big"), "remove \"big\"");
+  CHECK (remove ("holey"), "remove \"holey\"");
+}
@@ -0,0 +1,26 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-sparse-lazy) begin
+(grow-sparse-lazy) create "big"
+(grow-sparse-lazy) creating "big" allocated no data sectors
+(grow-sparse-lazy) open "big"
+(grow-sparse-lazy) check size of "big"
+(grow-sparse-lazy) read "big"
+(grow-sparse-lazy) close "big"
+(grow-sparse-lazy) create "holey"
+(grow-sparse-lazy) open "holey"
+(grow-sparse-lazy) seek "holey"
+(grow-sparse-lazy) write "holey"
+(grow-sparse-lazy) write allocated only the sector written and its map
+(grow-sparse-lazy) close "holey"
+(grow-sparse-lazy) open "holey" for verification
+(grow-sparse-lazy) verified contents of "holey"
+(grow-sparse-lazy) close "holey"
+(grow-sparse-lazy) remove "big"
+(grow-sparse-lazy) remove "holey"
+(grow-sparse-lazy) end
+EOF
+pass;
@@ -0,0 +1,5 @@
+/* Grows two files in parallel and checks that their contents are
+   correct, on a kernel that gives new files extents, so that each
+   file's runs are interleaved with the other's. */
+
+#include "tests/filesys/extended/grow-two-files.c"
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+my ($b) = random_bytes (5000);
+my ($c) = random_bytes (100);
+my ($tree) = {"a" => {"b" => [$b], "d" => {}}, "c" => [$c]};
+$tree->{"e$_"} = [''] for 0...9;
+check_archive ($tree);
+pass;
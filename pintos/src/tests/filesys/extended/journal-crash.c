@@ -0,0 +1,65 @@
+/* Builds a small tree, then simulates a power failure partway
+   through writing its metadata home.  The metadata journal has
+   to put the rest in place at the next boot, which the
+   persistence check verifies.  Also checks that creating a few
+   files needs at most a couple of journal commits, since their
+   metadata changes are grouped into one transaction. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define B_SIZE 5000
+#define C_SIZE 100
+#define SMALL_CNT 10
+
+static char buf_b[B_SIZE];
+static char buf_c[C_SIZE];
+
+/* Creates FILE_NAME holding the SIZE bytes in BUF. */
+static void
+make_file (const char *file_name, const char *buf, size_t size)
+{
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (write (fd, buf, size) == (int) size, "write \"%s\"", file_name);
+  close (fd);
+}
+
+void
+test_main (void)
+{
+  struct cache_stats before, after;
+  char file_name[16];
+  int i;
+
+  random_init (0);
+  random_bytes (buf_b, sizeof buf_b);
+  random_bytes (buf_c, sizeof buf_c);
+
+  CHECK (mkdir ("a"), "mkdir \"a\"");
+  make_file ("a/b", buf_b, sizeof buf_b);
+  CHECK (mkdir ("a/d"), "mkdir \"a/d\"");
+  make_file ("c", buf_c, sizeof buf_c);
+
+  msg ("create %d empty files", SMALL_CNT);
+  cache_stats (&before);
+  for (i = 0; i < SMALL_CNT; i++)
+    {
+      snprintf (file_name, sizeof file_name, "e%d", i);
+      if (!create (file_name, 0))
+        fail ("create \"%s\" failed", file_name);
+    }
+  cache_stats (&after);
+  if (after.journal_commits - before.journal_commits > 2)
+    fail ("%u journal commits for %d creates",
+          after.journal_commits - before.journal_commits, SMALL_CNT);
+  msg ("creates shared a journal commit");
+
+  msg ("crash");
+  crash ();
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(journal-crash) begin
+(journal-crash) mkdir "a"
+(journal-crash) create "a/b"
+(journal-crash) open "a/b"
+(journal-crash) write "a/b"
+(journal-crash) mkdir "a/d"
+(journal-crash) create "c"
+(journal-crash) open "c"
+(journal-crash) write "c"
+(journal-crash) create 10 empty files
+(journal-crash) creates shared a journal commit
+(journal-crash) crash
+(journal-crash) end
+EOF
+pass;
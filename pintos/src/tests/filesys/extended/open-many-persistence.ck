@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my ($fs);
+$fs->{'many'}{"f$_"} = [''] foreach 0...499;
+check_archive ($fs);
+pass;
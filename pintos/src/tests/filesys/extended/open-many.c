@@ -0,0 +1,69 @@
+/* Creates many files, keeps a hundred of them open, and then
+   opens every file twice while those stay open.  Both opens of a
+   file have to reach the same inode, which inode_open() now finds
+   through a hash table rather than a scan of every open inode. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 500
+#define HELD_CNT 100
+
+static int held[HELD_CNT];
+
+static void
+name_file (char *name, size_t size, int i)
+{
+  snprintf (name, size, "/many/f%d", i);
+}
+
+void
+test_main (void)
+{
+  char name[32];
+  int i;
+
+  CHECK (mkdir ("/many"), "mkdir \"/many\"");
+  msg ("create %d files", FILE_CNT);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      name_file (name, sizeof name, i);
+      if (!create (name, 0))
+        fail ("create \"%s\" failed", name);
+    }
+
+  msg ("hold %d files open", HELD_CNT);
+  for (i = 0; i < HELD_CNT; i++)
+    {
+      name_file (name, sizeof name, i * (FILE_CNT / HELD_CNT));
+      held[i] = open (name);
+      if (held[i] < 2)
+        fail ("open \"%s\" failed", name);
+    }
+
+  msg ("open every file twice");
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      int a, b;
+
+      name_file (name, sizeof name, i);
+      a = open (name);
+      b = open (name);
+      if (a < 2 || b < 2)
+        fail ("open \"%s\" failed", name);
+      if (inumber (a) != inumber (b))
+        fail ("\"%s\" opened as inodes %d and %d", name,
+              inumber (a), inumber (b));
+      if (i % (FILE_CNT / HELD_CNT) == 0
+          && inumber (a) != inumber (held[i / (FILE_CNT / HELD_CNT)]))
+        fail ("\"%s\" reopened as a different inode", name);
+      close (a);
+      close (b);
+    }
+
+  msg ("close held files");
+  for (i = 0; i < HELD_CNT; i++)
+    close (held[i]);
+}
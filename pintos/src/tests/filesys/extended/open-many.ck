@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(open-many) begin
+(open-many) mkdir "/many"
+(open-many) create 500 files
+(open-many) hold 100 files open
+(open-many) open every file twice
+(open-many) close held files
+(open-many) end
+EOF
+pass;
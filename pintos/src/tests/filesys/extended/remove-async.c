@@ -0,0 +1,52 @@
+/* Removes a 2 MB file while it is open, then closes it.  The
+   close must hand the file's sectors to the reclaimer rather
+   than free them itself.  The disk has room for only one such
+   file (see Make.tests), so writing a second one checks that the
+   sectors do come back. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (2 * 1024 * 1024)
+#define CHUNK_SIZE (64 * 1024)
+
+static char buf[CHUNK_SIZE];
+
+/* Creates FILE_NAME and writes FILE_SIZE bytes to it.  Returns
+   the open file. */
+static int
+write_file (const char *file_name)
+{
+  int fd, ofs;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += CHUNK_SIZE)
+    if (write (fd, buf, sizeof buf) != sizeof buf)
+      fail ("write \"%s\" at offset %d failed", file_name, ofs);
+  msg ("wrote %d MB to \"%s\"", FILE_SIZE / (1024 * 1024), file_name);
+  return fd;
+}
+
+void
+test_main (void)
+{
+  struct cache_stats before, after;
+  int fd;
+
+  fd = write_file ("first");
+  CHECK (remove ("first"), "remove \"first\"");
+
+  cache_stats (&before);
+  msg ("close \"first\"");
+  close (fd);
+  cache_stats (&after);
+  CHECK (after.reclaims_queued - before.reclaims_queued == 1,
+         "close left freeing to the reclaimer");
+
+  fd = write_file ("second");
+  msg ("close \"second\"");
+  close (fd);
+  CHECK (remove ("second"), "remove \"second\"");
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(remove-async) begin
+(remove-async) create "first"
+(remove-async) open "first"
+(remove-async) wrote 2 MB to "first"
+(remove-async) remove "first"
+(remove-async) close "first"
+(remove-async) close left freeing to the reclaimer
+(remove-async) create "second"
+(remove-async) open "second"
+(remove-async) wrote 2 MB to "second"
+(remove-async) close "second"
+(remove-async) remove "second"
+(remove-async) end
+EOF
+pass;
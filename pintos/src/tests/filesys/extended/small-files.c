@@ -0,0 +1,72 @@
+/* Creates many files smaller than a sector, then reads each one
+   back.  Files that small are kept in their inode's own sector,
+   so creating them should take about one sector per file, and
+   reading an open one should not need the buffer cache at all. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 40
+#define FILE_SIZE 300
+
+/* Sectors allowed beyond one inode per file, for the directory
+   to grow into. */
+#define SLACK 4
+
+static char buf[FILE_CNT][FILE_SIZE];
+static char actual[FILE_SIZE];
+
+void
+test_main (void)
+{
+  struct cache_stats before, after;
+  unsigned lookups = 0;
+  char file_name[16];
+  int fd;
+  int i;
+
+  msg ("create %d files of %d bytes", FILE_CNT, FILE_SIZE);
+  random_bytes (buf, sizeof buf);
+  cache_stats (&before);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (file_name, sizeof file_name, "small-%d", i);
+      if (!create (file_name, 0))
+        fail ("create \"%s\" failed", file_name);
+      if ((fd = open (file_name)) < 2)
+        fail ("open \"%s\" failed", file_name);
+      if (write (fd, buf[i], FILE_SIZE) != FILE_SIZE)
+        fail ("write \"%s\" failed", file_name);
+      close (fd);
+    }
+  cache_stats (&after);
+  CHECK (before.free_sectors - after.free_sectors <= FILE_CNT + SLACK,
+         "about one sector used per file");
+
+  msg ("read back %d files", FILE_CNT);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (file_name, sizeof file_name, "small-%d", i);
+      if ((fd = open (file_name)) < 2)
+        fail ("open \"%s\" failed", file_name);
+      cache_stats (&before);
+      if (read (fd, actual, FILE_SIZE) != FILE_SIZE)
+        fail ("read \"%s\" failed", file_name);
+      cache_stats (&after);
+      lookups += (after.hits - before.hits) + (after.misses - before.misses);
+      compare_bytes (actual, buf[i], FILE_SIZE, 0, file_name);
+      close (fd);
+    }
+  CHECK (lookups == 0, "reads did not go through the buffer cache");
+
+  msg ("remove %d files", FILE_CNT);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (file_name, sizeof file_name, "small-%d", i);
+      if (!remove (file_name))
+        fail ("remove \"%s\" failed", file_name);
+    }
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(small-files) begin
+(small-files) create 40 files of 300 bytes
+(small-files) about one sector used per file
+(small-files) read back 40 files
+(small-files) reads did not go through the buffer cache
+(small-files) remove 40 files
+(small-files) end
+EOF
+pass;
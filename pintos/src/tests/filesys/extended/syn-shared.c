@@ -0,0 +1,38 @@
+/* Spawns several children that share one file.  Each child
+   overwrites its own stripe of the file in small, unaligned
+   pieces while the others read and write theirs, so readers and
+   in-place writers hold the inode at the same time.  No write
+   may tear a neighbor's data or change the file's length. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/filesys/extended/syn-shared.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[FILE_SIZE];
+static char expected[FILE_SIZE];
+
+void
+test_main (void)
+{
+  pid_t children[CHILD_CNT];
+  int fd;
+  int i;
+
+  CHECK (create (file_name, FILE_SIZE), "create \"%s\"", file_name);
+
+  exec_children ("child-syn-shared", children, CHILD_CNT);
+  wait_children (children, CHILD_CNT);
+
+  for (i = 0; i < CHILD_CNT; i++)
+    memset (expected + i * STRIPE_SIZE, stripe_byte (i, PASS_CNT - 1),
+            STRIPE_SIZE);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (filesize (fd) == FILE_SIZE, "check size of \"%s\"", file_name);
+  CHECK (read (fd, buf, sizeof buf) == FILE_SIZE, "read \"%s\"", file_name);
+  compare_bytes (buf, expected, sizeof buf, 0, file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  CHECK (remove (file_name), "remove \"%s\"", file_name);
+}
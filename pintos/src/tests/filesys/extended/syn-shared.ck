@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(syn-shared) begin
+(syn-shared) create "shared"
+(syn-shared) exec child 1 of 4: "child-syn-shared 0"
+(syn-shared) exec child 2 of 4: "child-syn-shared 1"
+(syn-shared) exec child 3 of 4: "child-syn-shared 2"
+(syn-shared) exec child 4 of 4: "child-syn-shared 3"
+(syn-shared) wait for child 1 of 4 returned 0 (expected 0)
+(syn-shared) wait for child 2 of 4 returned 1 (expected 1)
+(syn-shared) wait for child 3 of 4 returned 2 (expected 2)
+(syn-shared) wait for child 4 of 4 returned 3 (expected 3)
+(syn-shared) open "shared"
+(syn-shared) check size of "shared"
+(syn-shared) read "shared"
+(syn-shared) close "shared"
+(syn-shared) remove "shared"
+(syn-shared) end
+EOF
+pass;
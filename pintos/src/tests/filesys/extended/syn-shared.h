@@ -0,0 +1,19 @@
+#ifndef TESTS_FILESYS_EXTENDED_SYN_SHARED_H
+#define TESTS_FILESYS_EXTENDED_SYN_SHARED_H
+
+#define CHILD_CNT 4
+#define STRIPE_SIZE (6 * 512)
+#define FILE_SIZE (CHILD_CNT * STRIPE_SIZE)
+#define CHUNK_SIZE 100
+#define PASS_CNT 8
+
+static char file_name[] = "shared";
+
+/* Byte that child CHILD_IDX fills its stripe with on PASS. */
+static inline char
+stripe_byte (int child_idx, int pass)
+{
+  return 'a' + child_idx * PASS_CNT + pass;
+}
+
+#endif /* tests/filesys/extended/syn-shared.h */
@@ -0,0 +1,131 @@
+/* Exercises pread(), pwrite(), readv(), writev(), preadv() and
+   pwritev() against a model of the file kept in memory: the
+   positional calls must leave the file position alone, the
+   vectored ones must fill and drain their buffers in order
+   across sector boundaries, and one preadv() of a run of
+   records must return what a seek() and read() per record
+   does. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 4096
+#define RECORD_SIZE 100
+#define RECORD_CNT 16
+#define RECORD_OFS 300
+
+static char model[FILE_SIZE + 512];
+static char buf[FILE_SIZE + 512];
+static char piece[3][600];
+static char records[RECORD_CNT][RECORD_SIZE];
+static char records2[RECORD_CNT][RECORD_SIZE];
+
+/* Reads the whole of FD with pread() and compares it against
+   the first SIZE bytes of the model. */
+static void
+check_model (int fd, int size)
+{
+  CHECK (filesize (fd) == size, "filesize is %d", size);
+  if (pread (fd, buf, size, 0) != size)
+    fail ("pread of the whole file failed");
+  compare_bytes (buf, model, size, 0, "f");
+}
+
+void
+test_main (void)
+{
+  struct iovec iov[RECORD_CNT];
+  int fd, i, ofs;
+
+  CHECK (create ("f", 0), "create \"f\"");
+  CHECK ((fd = open ("f")) > 1, "open \"f\"");
+  random_bytes (model, FILE_SIZE);
+  CHECK (write (fd, model, FILE_SIZE) == FILE_SIZE,
+         "write %d bytes", FILE_SIZE);
+
+  /* Positional calls leave the position alone. */
+  seek (fd, 10);
+  random_bytes (model + 700, 100);
+  CHECK (pwrite (fd, model + 700, 100, 700) == 100, "pwrite 100 bytes");
+  CHECK (pread (fd, buf, 50, 4070) == 26, "pread across end of file");
+  compare_bytes (buf, model + 4070, 26, 4070, "f");
+  CHECK (tell (fd) == 10, "position unchanged");
+
+  /* writev() at the position, spanning sectors. */
+  random_bytes (piece, sizeof piece);
+  iov[0].iov_base = piece[0];
+  iov[0].iov_len = 10;
+  iov[1].iov_base = piece[1];
+  iov[1].iov_len = 0;
+  iov[2].iov_base = piece[2];
+  iov[2].iov_len = 600;
+  iov[3].iov_base = piece[1];
+  iov[3].iov_len = 300;
+  seek (fd, 1000);
+  CHECK (writev (fd, iov, 4) == 910, "writev 910 bytes at 1000");
+  memcpy (model + 1000, piece[0], 10);
+  memcpy (model + 1010, piece[2], 600);
+  memcpy (model + 1610, piece[1], 300);
+  CHECK (tell (fd) == 1910, "position advanced to 1910");
+  check_model (fd, FILE_SIZE);
+
+  /* readv() at the position. */
+  memset (piece, 0, sizeof piece);
+  iov[0].iov_base = piece[0];
+  iov[0].iov_len = 513;
+  iov[1].iov_base = piece[1];
+  iov[1].iov_len = 1;
+  iov[2].iov_base = piece[2];
+  iov[2].iov_len = 600;
+  seek (fd, 995);
+  CHECK (readv (fd, iov, 3) == 1114, "readv 1114 bytes at 995");
+  compare_bytes (piece[0], model + 995, 513, 995, "f");
+  compare_bytes (piece[1], model + 1508, 1, 1508, "f");
+  compare_bytes (piece[2], model + 1509, 600, 1509, "f");
+  CHECK (tell (fd) == 2109, "position advanced to 2109");
+
+  /* A run of records, one seek() and read() each, then all at
+     once with preadv(). */
+  for (i = 0; i < RECORD_CNT; i++)
+    {
+      seek (fd, RECORD_OFS + i * RECORD_SIZE);
+      if (read (fd, records[i], RECORD_SIZE) != RECORD_SIZE)
+        fail ("read of record %d failed", i);
+    }
+  msg ("read %d records with seek and read", RECORD_CNT);
+  for (i = 0; i < RECORD_CNT; i++)
+    {
+      iov[i].iov_base = records2[i];
+      iov[i].iov_len = RECORD_SIZE;
+    }
+  CHECK (preadv (fd, iov, RECORD_CNT, RECORD_OFS)
+         == RECORD_CNT * RECORD_SIZE,
+         "read %d records with one preadv", RECORD_CNT);
+  for (i = 0; i < RECORD_CNT; i++)
+    compare_bytes (records2[i], records[i], RECORD_SIZE,
+                   RECORD_OFS + i * RECORD_SIZE, "f");
+
+  /* pwritev() past the end grows the file and leaves a hole. */
+  ofs = FILE_SIZE + 100;
+  memset (model + FILE_SIZE, 0, 100);
+  for (i = 0; i < 4; i++)
+    {
+      random_bytes (records[i], RECORD_SIZE);
+      iov[i].iov_base = records[i];
+      iov[i].iov_len = RECORD_SIZE;
+      memcpy (model + ofs + i * RECORD_SIZE, records[i], RECORD_SIZE);
+    }
+  CHECK (pwritev (fd, iov, 4, ofs) == 4 * RECORD_SIZE,
+         "pwritev %d bytes past end of file", 4 * RECORD_SIZE);
+  check_model (fd, ofs + 4 * RECORD_SIZE);
+
+  CHECK (pread (fd + 100, buf, 10, 0) == -1, "pread of a bad fd fails");
+  CHECK (readv (fd, iov, IOV_MAX + 1) == -1, "readv of too many buffers fails");
+
+  msg ("close \"f\"");
+  close (fd);
+  CHECK (remove ("f"), "remove \"f\"");
+}
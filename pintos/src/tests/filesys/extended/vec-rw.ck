@@ -0,0 +1,28 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(vec-rw) begin
+(vec-rw) create "f"
+(vec-rw) open "f"
+(vec-rw) write 4096 bytes
+(vec-rw) pwrite 100 bytes
+(vec-rw) pread across end of file
+(vec-rw) position unchanged
+(vec-rw) writev 910 bytes at 1000
+(vec-rw) position advanced to 1910
+(vec-rw) filesize is 4096
+(vec-rw) readv 1114 bytes at 995
+(vec-rw) position advanced to 2109
+(vec-rw) read 16 records with seek and read
+(vec-rw) read 16 records with one preadv
+(vec-rw) pwritev 400 bytes past end of file
+(vec-rw) filesize is 4596
+(vec-rw) pread of a bad fd fails
+(vec-rw) readv of too many buffers fails
+(vec-rw) close "f"
+(vec-rw) remove "f"
+(vec-rw) end
+EOF
+pass;
@@ -99,6 +99,7 @@ struct thread
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
     struct dir *cwd;                    /* The current working directory of the process */
+    int journal_depth;                  /* Nested journal_begin() calls. */
 
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
@@ -1,5 +1,7 @@
 #include <stdio.h>
 #include <syscall-nr.h>
+#include <string.h>
+#include <uio.h>
 #include "userprog/syscall.h"
 #include "userprog/pagedir.h"
 #include "devices/shutdown.h"
@@ -61,6 +63,54 @@ sys_fd_lookup (int fd)
   return t->fd_table[fd];
 }
 
+/* Returns the open file FD names, or a null pointer if FD is not
+   an open file. */
+static struct file *
+sys_file_lookup (int fd)
+{
+  struct fd_obj *ptr = sys_fd_lookup (fd);
+
+  if ((int)ptr == -1 || ptr == NULL || ptr->is_dir)
+    return NULL;
+  return ptr->file_ptr;
+}
+
+/* Returns true if all SIZE bytes starting at UADDR are mapped
+   user memory. */
+static bool
+user_range_ok (const void *uaddr, size_t size)
+{
+  const uint8_t *first = uaddr;
+  const uint8_t *last = first + size - 1;
+  const uint8_t *page;
+
+  if (size == 0)
+    return true;
+  if (first == NULL || last < first || !is_user_vaddr (last))
+    return false;
+  for (page = pg_round_down (first); page <= last; page += PGSIZE)
+    if (!pagedir_get_page (thread_current ()->pagedir, page))
+      return false;
+  return true;
+}
+
+/* Copies the IOVCNT-element I/O vector at UIOV in user memory
+   into IOV, checking it and every buffer it names once up front.
+   Exits the process if any of it is not mapped user memory. */
+static void
+copy_in_iov (struct intr_frame *f, struct iovec *iov,
+             const struct iovec *uiov, int iovcnt)
+{
+  int i;
+
+  if (!user_range_ok (uiov, iovcnt * sizeof *uiov))
+    sys_exit (f, -1);
+  memcpy (iov, uiov, iovcnt * sizeof *uiov);
+  for (i = 0; i < iovcnt; i++)
+    if (!user_range_ok (iov[i].iov_base, iov[i].iov_len))
+      sys_exit (f, -1);
+}
+
 static void
 syscall_handler (struct intr_frame *f UNUSED)
 {
@@ -231,6 +281,10 @@ syscall_handler (struct intr_frame *f UNUSED)
         } else if (file_ptr == NULL) {
           f->eax = -1;
         } else {
+          /* Past the largest file, reads see EOF and writes fail;
+             clamping keeps the position a valid off_t. */
+          if (position > (unsigned) INODE_MAX_LENGTH)
+            position = INODE_MAX_LENGTH;
           file_seek (file_ptr, position);
         }
         break;
@@ -370,6 +424,117 @@ syscall_handler (struct intr_frame *f UNUSED)
         f->eax = get_cache_write_cnt ();
         break;
       }
+      case SYS_CACHE_STATS: {
+        struct cache_stats *stats = (struct cache_stats *) args[1];
+        void *last = (uint8_t *) (stats + 1) - 1;
+        if (!is_user_vaddr (last) || !pagedir_get_page (t->pagedir, stats)
+            || !pagedir_get_page (t->pagedir, last)) {
+          sys_exit (f, -1);
+        }
+        cache_get_stats (stats);
+        break;
+      }
+      case SYS_OPEN_DIRECT: {
+        if (!args[1] || !is_user_vaddr((void*)args[1]) || !pagedir_get_page(t->pagedir, (void*)args[1])) {
+          sys_exit(f, -1);
+        }
+        char *filename = (char *) args[1];
+        int fd = request_fd(t);
+        if (!filesys_open_r (filename, t->fd_table[fd])) {
+          f->eax = -1;
+        } else {
+          if (!t->fd_table[fd]->is_dir)
+            file_set_direct (t->fd_table[fd]->file_ptr, true);
+          f->eax = fd;
+        }
+        break;
+      }
+      case SYS_CRASH: {
+        if (!filesys_crash_enabled) {
+          sys_exit (f, -1);
+        }
+        filesys_crash ();
+        break;
+      }
+      case SYS_FSYNC:
+      case SYS_FDATASYNC: {
+        if (!is_user_vaddr((void*)&args[1]) || !pagedir_get_page(t->pagedir, (void*)&args[1])) {
+          sys_exit(f, -1);
+        }
+        int fd = (int) args[1];
+        bool data_only = args[0] == SYS_FDATASYNC;
+        struct fd_obj *ptr = sys_fd_lookup (fd);
+
+        if ((int)ptr == -1 || ptr == NULL) {
+          f->eax = -1;
+        } else if (ptr->is_dir) {
+          inode_sync (dir_get_inode (ptr->dir_ptr), data_only);
+          f->eax = 0;
+        } else if (ptr->file_ptr == NULL) {
+          f->eax = -1;
+        } else {
+          file_sync (ptr->file_ptr, data_only);
+          f->eax = 0;
+        }
+        break;
+      }
+      case SYS_PREAD:
+      case SYS_PWRITE: {
+        if (!user_range_ok (&args[1], 4 * sizeof *args)) {
+          sys_exit(f, -1);
+        }
+        struct file *file_ptr = sys_file_lookup ((int) args[1]);
+        void *buffer = (void *) args[2];
+        off_t size = args[3] < (unsigned) INODE_MAX_LENGTH ? args[3] : INODE_MAX_LENGTH;
+        off_t offset = args[4] < (unsigned) INODE_MAX_LENGTH ? args[4] : INODE_MAX_LENGTH;
+
+        if (!user_range_ok (buffer, size)) {
+          sys_exit(f, -1);
+        }
+        if (file_ptr == NULL) {
+          f->eax = -1;
+        } else if (args[0] == SYS_PREAD) {
+          f->eax = file_read_at (file_ptr, buffer, size, offset);
+        } else {
+          f->eax = file_write_at (file_ptr, buffer, size, offset);
+        }
+        break;
+      }
+      case SYS_READV:
+      case SYS_WRITEV:
+      case SYS_PREADV:
+      case SYS_PWRITEV: {
+        bool positional = args[0] == SYS_PREADV || args[0] == SYS_PWRITEV;
+        bool reading = args[0] == SYS_READV || args[0] == SYS_PREADV;
+        if (!user_range_ok (&args[1], (positional ? 4 : 3) * sizeof *args)) {
+          sys_exit(f, -1);
+        }
+        struct file *file_ptr = sys_file_lookup ((int) args[1]);
+        const struct iovec *uiov = (const struct iovec *) args[2];
+        int iovcnt = (int) args[3];
+        off_t offset = 0;
+        struct iovec iov[IOV_MAX];
+
+        if (positional)
+          offset = args[4] < (unsigned) INODE_MAX_LENGTH ? args[4] : INODE_MAX_LENGTH;
+        if (iovcnt < 0 || iovcnt > IOV_MAX) {
+          f->eax = -1;
+          break;
+        }
+        copy_in_iov (f, iov, uiov, iovcnt);
+        if (file_ptr == NULL) {
+          f->eax = -1;
+        } else if (positional) {
+          f->eax = (reading
+                    ? file_readv_at (file_ptr, iov, iovcnt, offset)
+                    : file_writev_at (file_ptr, iov, iovcnt, offset));
+        } else {
+          f->eax = (reading
+                    ? file_readv (file_ptr, iov, iovcnt)
+                    : file_writev (file_ptr, iov, iovcnt));
+        }
+        break;
+      }
     }
   }
 }